@@ -71,9 +71,9 @@ static void usage();
 int main(int argc, char **argv)
 {
 	extern int optind;
-	int c;
+	int c, err;
 	char *p;
-	int (*fcall)();
+	int (*fcall)() = NULL;
 
 	if (argc < 3)
 		usage();
@@ -92,7 +92,7 @@ int main(int argc, char **argv)
 		argv[1] = p;
 	}
 
-	while ((c = getopt(argc, argv, "abcdilmopqrTtuvx")) != EOF) {
+	while ((c = getopt(argc, argv, "abcdilmopqrsTtuvx")) != EOF) {
 		switch(c) {
 		case 'a':
 			options |= AR_A;
@@ -130,6 +130,9 @@ int main(int argc, char **argv)
 			options |= AR_R;
 			fcall = replace;
 			break;
+		case 's':
+			options |= AR_S;
+			break;
 		case 'T':
 			options |= AR_TR;
 			break;
@@ -155,11 +158,14 @@ int main(int argc, char **argv)
 	argv += optind;
 	argc -= optind;
 
-	/* One of -dmpqrtx required. */
+	/* One of -dmpqrtx required, or -s on its own. */
 	if (!(options & (AR_D|AR_M|AR_P|AR_Q|AR_R|AR_T|AR_X))) {
-		fprintf(stderr,
-		    "ar: one of options -dmpqrtx is required.\n");
-		usage();
+		if (options != AR_S) {
+			fprintf(stderr,
+			    "ar: one of options -dmpqrstx is required.\n");
+			usage();
+		}
+		fcall = ranlib;
 	}
 	/* Only one of -a and -bi allowed. */
 	if (options & AR_A && options & AR_B) {
@@ -176,20 +182,21 @@ int main(int argc, char **argv)
 		}
 		posname = rname(posarg);
 	}
-	/* -d only valid with -Tv. */
-	if (options & AR_D && options & ~(AR_D|AR_TR|AR_V))
+	/* -d only valid with -sTv. */
+	if (options & AR_D && options & ~(AR_D|AR_S|AR_TR|AR_V))
 		badoptions("-d");
-	/* -m only valid with -abiTv. */
-	if (options & AR_M && options & ~(AR_A|AR_B|AR_M|AR_TR|AR_V))
+	/* -m only valid with -abisTv. */
+	if (options & AR_M && options & ~(AR_A|AR_B|AR_M|AR_S|AR_TR|AR_V))
 		badoptions("-m");
 	/* -p only valid with -Tv. */
 	if (options & AR_P && options & ~(AR_P|AR_TR|AR_V))
 		badoptions("-p");
-	/* -q only valid with -cTv. */
-	if (options & AR_Q && options & ~(AR_C|AR_Q|AR_TR|AR_V))
+	/* -q only valid with -csTv. */
+	if (options & AR_Q && options & ~(AR_C|AR_Q|AR_S|AR_TR|AR_V))
 		badoptions("-q");
-	/* -r only valid with -abcuTv. */
-	if (options & AR_R && options & ~(AR_A|AR_B|AR_C|AR_R|AR_U|AR_TR|AR_V))
+	/* -r only valid with -abcsuTv. */
+	if (options & AR_R &&
+	    options & ~(AR_A|AR_B|AR_C|AR_R|AR_S|AR_U|AR_TR|AR_V))
 		badoptions("-r");
 	/* -t only valid with -Tv. */
 	if (options & AR_T && options & ~(AR_T|AR_TR|AR_V))
@@ -209,7 +216,12 @@ int main(int argc, char **argv)
 		usage();
 	}
 
-	exit((*fcall)(argv));
+	err = (*fcall)(argv);
+	/* Keep the symbol index in step with any change to the members */
+	if (!err && fcall != ranlib && options & (AR_D|AR_M|AR_Q|AR_R) &&
+	    (options & AR_S || hasindex()))
+		err = ranlib(NULL);
+	exit(err);
 	return(0);
 }
 
@@ -222,13 +234,14 @@ static void badoptions(char *arg)
 
 static void usage()
 {
-	fprintf(stderr, "usage:  ar -d [-Tv] archive file ...\n");
-	fprintf(stderr, "\tar -m [-Tv] archive file ...\n");
-	fprintf(stderr, "\tar -m [-abiTv] position archive file ...\n");
+	fprintf(stderr, "usage:  ar -d [-sTv] archive file ...\n");
+	fprintf(stderr, "\tar -m [-sTv] archive file ...\n");
+	fprintf(stderr, "\tar -m [-abisTv] position archive file ...\n");
 	fprintf(stderr, "\tar -p [-Tv] archive [file ...]\n");
-	fprintf(stderr, "\tar -q [-cTv] archive file ...\n");
-	fprintf(stderr, "\tar -r [-cuTv] archive file ...\n");
-	fprintf(stderr, "\tar -r [-abciuTv] position archive file ...\n");
+	fprintf(stderr, "\tar -q [-csTv] archive file ...\n");
+	fprintf(stderr, "\tar -r [-csuTv] archive file ...\n");
+	fprintf(stderr, "\tar -r [-abcisuTv] position archive file ...\n");
+	fprintf(stderr, "\tar -s archive\n");
 	fprintf(stderr, "\tar -t [-Tv] archive [file ...]\n");
 	fprintf(stderr, "\tar -x [-ouTv] archive [file ...]\n");
 	exit(1);
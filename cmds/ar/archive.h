@@ -55,6 +55,7 @@
 #define	AR_U	0x0800
 #define	AR_V	0x1000
 #define	AR_X	0x2000
+#define	AR_S	0x4000
 extern u_int options;
 
 /* Set up file copy. */
@@ -119,5 +120,7 @@ void badfmt(void);
 void error(char *name);
 int move(char **argv);
 int print(char **argv);
+int ranlib(char **argv);
+int hasindex(void);
 int replace(char **argv);
 void strmode(register mode_t mode, char *p);
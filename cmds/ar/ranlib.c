@@ -0,0 +1,159 @@
+/*
+ * Symbol index support for the Fuzix linker. The index is kept as the
+ * first member of the archive so ld can find a module by the symbols it
+ * defines without reading every member.
+ */
+
+#include <sys/param.h>
+#include <sys/stat.h>
+#include <time.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <ar.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include "archive.h"
+#include "extern.h"
+#include "../bintools/obj.h"
+
+extern CHDR chdr;			/* converted header */
+extern char *archive;			/* archive name */
+extern char *tname;			/* temporary file "name" */
+
+static int isindex(void)
+{
+	return(!strcmp(chdr.name, RANLIB_NAME));
+}
+
+/*
+ * symdefs --
+ *	Add an index entry for each symbol defined by the object module
+ *	at the current offset in the archive.  The offset recorded is that
+ *	of the member header, relative to the first member after the index.
+ */
+static int symdefs(int afd, int tfd, off_t rel)
+{
+	struct objhdr oh;
+	uint8_t ent[S_ENTRYSIZE];
+	uint8_t out[RANLIB_ENTRYSIZE];
+	off_t base;
+	int nsym, n;
+
+	base = lseek(afd, (off_t)0, SEEK_CUR);
+	if (chdr.size < sizeof(oh) || read(afd, &oh, sizeof(oh)) != sizeof(oh))
+		return(0);
+	if (oh.o_magic != MAGIC_OBJ || oh.o_symbase == 0 ||
+	    oh.o_dbgbase > chdr.size)
+		return(0);
+	lseek(afd, base + oh.o_symbase, SEEK_SET);
+	out[0] = rel;
+	out[1] = rel >> 8;
+	out[2] = rel >> 16;
+	out[3] = rel >> 24;
+	n = 0;
+	for (nsym = (oh.o_dbgbase - oh.o_symbase) / S_ENTRYSIZE; nsym; nsym--) {
+		if (read(afd, ent, S_ENTRYSIZE) != S_ENTRYSIZE)
+			badfmt();
+		if (ent[0] & S_UNKNOWN)
+			continue;
+		bcopy(ent + 1, out + 4, NAMELEN);
+		if (write(tfd, out, RANLIB_ENTRYSIZE) != RANLIB_ENTRYSIZE)
+			error(tname);
+		n++;
+	}
+	return(n);
+}
+
+/*
+ * ranlib --
+ *	Handles the s option.  Builds a new symbol index and rewrites the
+ *	archive with it as the first member, dropping any old one.
+ */
+int ranlib(char **argv)
+{
+	struct ar_hdr *hdr;
+	char hb[sizeof(struct ar_hdr) + 1];
+	uint8_t out[RANLIB_ENTRYSIZE];
+	register int afd, tfd1, tfd2;
+	off_t hpos, rel, size, first;
+	long nsym;
+	CF cf;
+
+	afd = open_archive(O_RDWR);
+	tfd1 = tmp();			/* The index entries */
+	tfd2 = tmp();			/* Every other member */
+
+	/* Index every object module and keep the other members */
+	rel = 0;
+	nsym = 0;
+	for (;;) {
+		hpos = lseek(afd, (off_t)0, SEEK_CUR);
+		if (!get_arobj(afd))
+			break;
+		if (isindex()) {
+			skip_arobj(afd);
+			continue;
+		}
+		nsym += symdefs(afd, tfd1, rel);
+		lseek(afd, hpos, SEEK_SET);
+		get_arobj(afd);
+		/* Read and write to an archive; pad on both. */
+		SETCF(afd, archive, tfd2, tname, RPAD|WPAD);
+		put_arobj(&cf, (struct stat *)NULL);
+		rel = lseek(tfd2, (off_t)0, SEEK_CUR);
+	}
+
+	/* Now we know its size we can make the offsets absolute */
+	size = nsym * RANLIB_ENTRYSIZE;
+	first = SARMAG + sizeof(struct ar_hdr) + size + (size & 1);
+
+	lseek(afd, (off_t)SARMAG, SEEK_SET);
+	sprintf(hb, HDR2, RANLIB_NAME, (long)time(NULL), getuid(), getgid(),
+	    0644, (long)size, ARFMAG);
+	if (write(afd, hb, sizeof(*hdr)) != sizeof(*hdr))
+		error(archive);
+	lseek(tfd1, (off_t)0, SEEK_SET);
+	while (nsym--) {
+		if (read(tfd1, out, RANLIB_ENTRYSIZE) != RANLIB_ENTRYSIZE)
+			error(tname);
+		rel = first + (out[0] | (out[1] << 8) |
+		    ((off_t)out[2] << 16) | ((off_t)out[3] << 24));
+		out[0] = rel;
+		out[1] = rel >> 8;
+		out[2] = rel >> 16;
+		out[3] = rel >> 24;
+		if (write(afd, out, RANLIB_ENTRYSIZE) != RANLIB_ENTRYSIZE)
+			error(archive);
+	}
+	if (size & 1 && write(afd, "\n", 1) != 1)
+		error(archive);
+
+	size = lseek(tfd2, (off_t)0, SEEK_CUR);
+	lseek(tfd2, (off_t)0, SEEK_SET);
+	SETCF(tfd2, tname, afd, archive, NOPAD);
+	copy_ar(&cf, size);
+
+	ftruncate(afd, first + size);
+	close_archive(afd);
+	return(0);
+}
+
+/*
+ * hasindex --
+ *	Report if the archive starts with a symbol index so that changes
+ *	to it can keep the index up to date.
+ */
+int hasindex(void)
+{
+	int afd, r;
+	char buf[SARMAG];
+
+	if ((afd = open(archive, O_RDONLY)) < 0)
+		return(0);
+	r = read(afd, buf, SARMAG) == SARMAG && !bcmp(buf, ARMAG, SARMAG) &&
+	    get_arobj(afd) && isindex();
+	close(afd);
+	return(r);
+}
@@ -16,8 +16,7 @@
  * Table sizes, etc.
  */
 #define	NCPS	NAMELEN			/* # of characters in symbol */
-#define	NHASH	64			/* # of hash buckets */
-#define	HMASK	077			/* Mask for above */
+#define	NHASH	64			/* # of hash buckets to start with */
 #define	NFNAME	32			/* # of characters in filename */
 #define	NERR	10			/* Size of error buffer */
 #define	NCODE	128			/* # of characters in code buffer */
@@ -2208,8 +2207,19 @@ typedef	struct	SYM	{
 	uint16_t s_number;		/* Symbol number 1..n, also usable for
 					   tokens as extra data */
 	int	s_segment;		/* Segment this symbol is relative to */
+	unsigned s_hash;		/* Full hash of the name */
 }	SYM;
 
+/*
+ * Symbol hash table. Grows as
+ * symbols are added.
+ */
+typedef	struct	HTAB	{
+	SYM	**h_tab;		/* Buckets */
+	unsigned h_mask;		/* Number of buckets - 1 */
+	unsigned h_count;		/* Number of symbols */
+}	HTAB;
+
 /*
  * External variables.
  */
@@ -2224,8 +2234,8 @@ extern	int	lmode;
 extern	VALUE	laddr;
 extern	SYM	sym[];
 extern	int	pass;
-extern	SYM	*phash[];
-extern	SYM	*uhash[];
+extern	HTAB	phash;
+extern	HTAB	uhash;
 extern	int	lflag;
 extern	jmp_buf	env;
 extern	VALUE   dot[OSEG];
@@ -2238,17 +2248,19 @@ extern	int	cpu_flags;
 
 extern int passbegin(int pass);
 extern void list_addbyte(uint8_t);
+extern int cache_drop(void);
 extern void asmline(void);
 extern void comma(void);
 extern void istuser(ADDR *);
-extern int symhash(char *);
+extern unsigned symhash(char *);
 extern void err(char, uint8_t);
 extern void uerr(char *);
 extern void aerr(uint8_t);
 extern void qerr(uint8_t);
 extern void storerror(int);
 extern void getid(char *, int);
-extern SYM *lookup(char *, SYM *[], int);
+extern SYM *lookup(char *, HTAB *, int);
+extern void syminsert(HTAB *, SYM *);
 extern int symeq(char *, char *);
 extern void symcopy(char *, char *);
 extern int get(void);
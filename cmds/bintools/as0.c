@@ -21,8 +21,8 @@ char	*fname;
 char 	*listname;
 VALUE	dot[OSEG];
 int	segment = 1;
-SYM	*phash[NHASH];
-SYM	*uhash[NHASH];
+HTAB	phash;
+HTAB	uhash;
 int	pass;
 int	line;
 jmp_buf	env;
@@ -44,9 +44,11 @@ static void oom(void)
 
 static char *xstrdup(const char *p)
 {
-	char *n = strdup(p);
-	if (!n)
-		oom();
+	char *n;
+
+	while ((n = strdup(p)) == NULL)
+		if (!cache_drop())
+			oom();
 	return n;
 }
 
@@ -87,6 +89,104 @@ void list_endline(void)
 	}
 }
 
+/*
+ *	The source is read from the file once and kept in memory so that the
+ *	later passes can replay it without going back through stdio. If we run
+ *	out of memory, here or for the symbol table, we throw away what we have
+ *	and re-read the file on each pass as before.
+ */
+#define NCHUNK	2048
+
+struct chunk {
+	struct chunk *next;
+	unsigned len;
+	char data[NCHUNK];
+};
+
+static struct chunk *chead;
+static struct chunk *ctail;
+static struct chunk *cnext;
+static unsigned coff;
+static long cpos;		/* file offset of the next line replayed */
+static int incore;		/* 0 loading, 1 in memory, -1 from the file */
+
+/* Free the cache. If we are part way through replaying a pass, carry on
+   from the same place in the file. Returns 0 if there was nothing to free */
+int cache_drop(void)
+{
+	struct chunk *c;
+	int freed = chead != NULL;
+
+	while ((c = chead) != NULL) {
+		chead = c->next;
+		free(c);
+	}
+	ctail = NULL;
+	cnext = NULL;
+	if (incore == 1)
+		fseek(ifp, cpos, 0);
+	incore = -1;
+	return freed;
+}
+
+static void cache_line(void)
+{
+	unsigned n = strlen(ib) + 1;
+	struct chunk *c = ctail;
+
+	if (c == NULL || c->len + n > NCHUNK) {
+		c = malloc(sizeof(struct chunk));
+		if (c == NULL) {
+			cache_drop();
+			return;
+		}
+		c->next = NULL;
+		c->len = 0;
+		if (ctail)
+			ctail->next = c;
+		else
+			chead = c;
+		ctail = c;
+	}
+	memcpy(c->data + c->len, ib, n);
+	c->len += n;
+}
+
+static void source_rewind(void)
+{
+	if (incore == 1) {
+		cnext = chead;
+		coff = 0;
+		cpos = 0;
+	} else
+		fseek(ifp, 0L, 0);
+}
+
+static int source_line(void)
+{
+	if (incore == 1) {
+		while (cnext && coff == cnext->len) {
+			cnext = cnext->next;
+			coff = 0;
+		}
+		if (cnext == NULL)
+			return 0;
+		strcpy(ib, cnext->data + coff);
+		coff += strlen(ib) + 1;
+		cpos += strlen(ib);
+		return 1;
+	}
+	if (fgets(ib, NINPUT, ifp) == NULL) {
+		/* We have it all, play it back from now on */
+		if (incore == 0)
+			incore = 1;
+		return 0;
+	}
+	if (incore == 0)
+		cache_line();
+	return 1;
+}
+
 int main(int argc, char *argv[])
 {
 	char *ifn;
@@ -148,8 +248,8 @@ int main(int argc, char *argv[])
 			continue;
 		line = 1;
 		memset(dot, 0, sizeof(dot));
-		fseek(ifp, 0L, 0);
-		while (fgets(ib, NINPUT, ifp) != NULL) {
+		source_rewind();
+		while (source_line()) {
 			/* Pre-processor output */
 			if (*ib == '#' && ib[1] == ' ') {
 				free(fname);
@@ -699,7 +699,7 @@ loop:
 		qerr(UNEXPECTED_CHR);
 	getid(id, c);
 	if ((c=getnb()) == ':') {
-		sp = lookup(id, uhash, 1);
+		sp = lookup(id, &uhash, 1);
 		if (pass == 0) {
 			if ((sp->s_type&TMMODE) != TNEW
 			&&  (sp->s_type&TMASG) == 0)
@@ -732,9 +732,9 @@ loop:
 	 * assume that it is the name in front
 	 * of an "equ" assembler directive.
 	 */
-	if ((sp=lookup(id, phash, 0)) == NULL) {
+	if ((sp=lookup(id, &phash, 0)) == NULL) {
 		getid(id1, c);
-		if ((sp1=lookup(id1, phash, 0)) == NULL
+		if ((sp1=lookup(id1, &phash, 0)) == NULL
 		||  (sp1->s_type&TMMODE) != TEQU) {
 			err('o', SYNTAX_ERROR);
 			return;
@@ -742,7 +742,7 @@ loop:
 		getaddr(&a1);
 		constify(&a1);
 		istuser(&a1);
-		sp = lookup(id, uhash, 1);
+		sp = lookup(id, &uhash, 1);
 		if ((sp->s_type&TMMODE) != TNEW
 		&&  (sp->s_type&TMASG) == 0)
 			err('m', MULTIPLE_DEFS);
@@ -772,7 +772,7 @@ loop:
 
 	case TEXPORT:
 		getid(id, getnb());
-		sp = lookup(id, uhash, 1);
+		sp = lookup(id, &uhash, 1);
 		sp->s_type |= TPUBLIC;
 		break;
 		/* .code etc */
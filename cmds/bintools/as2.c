@@ -7,22 +7,99 @@
 
 /*
  * Given a pointer to a
- * sumbol, compute the hash bucket
- * number. The "add all the characters
- * and take the result modulo the table
- * size" algorithm is used.
+ * symbol, compute the hash of
+ * the name. Just adding up the characters
+ * clusters badly on names like __mul16
+ * and __mul32 so use the "times 33 xor"
+ * hash. The caller masks off the
+ * bucket number.
  */
-int symhash(char *id)
+unsigned symhash(char *id)
 {
-	int hash;
+	unsigned hash;
 	int n;
 
-	hash = 0;
+	hash = 5381;
 	n = NCPS;
 	do {
-		hash += *id++;
+		if (*id == 0)
+			break;
+		hash = ((hash << 5) + hash) ^ *id++;
 	} while (--n);
-	return (hash&HMASK);
+	return (hash);
+}
+
+static void nomem(void)
+{
+	fprintf(stderr, "No memory\n");
+	exit(BAD);
+}
+
+/*
+ * The symbol table matters more than
+ * the in-memory copy of the source, so
+ * give that up before failing.
+ */
+static void *symalloc(unsigned n, unsigned size)
+{
+	void *p;
+
+	while ((p = calloc(n, size)) == NULL && cache_drop())
+		;
+	return (p);
+}
+
+/*
+ * Double the number of buckets
+ * in a hash table and move the symbols
+ * over. If there is no memory we just
+ * keep the longer chains.
+ */
+static void symgrow(HTAB *htable)
+{
+	SYM **t;
+	SYM *sp, *np;
+	unsigned n, i;
+
+	n = htable->h_tab ? (htable->h_mask + 1) * 2 : NHASH;
+	t = (SYM **)symalloc(n, sizeof(SYM *));
+	if (t == NULL) {
+		if (htable->h_tab == NULL)
+			nomem();
+		return;
+	}
+	if (htable->h_tab) {
+		for (i = 0; i <= htable->h_mask; i++) {
+			for (sp = htable->h_tab[i]; sp != NULL; sp = np) {
+				np = sp->s_fp;
+				sp->s_fp = t[sp->s_hash & (n - 1)];
+				t[sp->s_hash & (n - 1)] = sp;
+			}
+		}
+		free(htable->h_tab);
+	}
+	htable->h_tab = t;
+	htable->h_mask = n - 1;
+}
+
+/*
+ * Add a symbol, whose s_hash
+ * is set, to a hash table. Symbols are
+ * numbered and written out in table
+ * order so the table must not be
+ * reshuffled after the first pass.
+ */
+void syminsert(HTAB *htable, SYM *sp)
+{
+	SYM **bp;
+
+	if (htable->h_tab == NULL ||
+		(pass == 0 && htable->h_count > 2 * htable->h_mask))
+		symgrow(htable);
+	bp = &htable->h_tab[sp->s_hash & htable->h_mask];
+	sp->s_fp = *bp;
+	*bp = sp;
+	htable->h_count++;
 }
 
 static void errstr(uint8_t code)
@@ -122,25 +199,25 @@ void getid(char *id, int c)
  * If not there, and "cf" is
  * true, create it.
  */
-SYM	*lookup(char *id, SYM *htable[], int cf)
+SYM	*lookup(char *id, HTAB *htable, int cf)
 {
 	SYM *sp;
-	int hash;
+	unsigned hash;
 
 	hash = symhash(id);
-	sp  = htable[hash];
+	sp = NULL;
+	if (htable->h_tab)
+		sp = htable->h_tab[hash & htable->h_mask];
 	while (sp != NULL) {
-		if (symeq(id, sp->s_id))
+		if (sp->s_hash == hash && symeq(id, sp->s_id))
 			return (sp);
 		sp = sp->s_fp;
 	}
 	if (cf != 0) {
-		if ((sp=(SYM *)malloc(sizeof(SYM))) == NULL) {
-			fprintf(stderr, "No memory\n");
-			exit(BAD);
-		}
-		sp->s_fp = htable[hash];
-		htable[hash] = sp;
+		if ((sp=(SYM *)symalloc(1, sizeof(SYM))) == NULL)
+			nomem();
+		sp->s_hash = hash;
+		syminsert(htable, sp);
 		sp->s_type = TNEW;
 		sp->s_value = 0;
 		sp->s_segment = UNKNOWN;
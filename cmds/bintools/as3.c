@@ -239,9 +239,9 @@ void expr2(ADDR *ap)
 	}
 	if (isalpha(c) || c == '_') {
 		getid(id, c);
-		if ((sp=lookup(id, uhash, 0)) == NULL
-		&&  (sp=lookup(id, phash, 0)) == NULL)
-			sp = lookup(id, uhash, 1);
+		if ((sp=lookup(id, &uhash, 0)) == NULL
+		&&  (sp=lookup(id, &phash, 0)) == NULL)
+			sp = lookup(id, &uhash, 1);
 		mode = sp->s_type&TMMODE;
 		if (mode==TBR || mode==TWR || mode==TSR || mode==TCC) {
 			ap->a_type  = mode|sp->s_value;
@@ -404,12 +404,14 @@ static void enumerate(SYM *s, FILE *dummy)
 	s->s_number = sym++;
 }
 
-static void dosymbols(SYM *hash[], FILE *ofp, int flag, void (*op)(SYM *, FILE *f))
+static void dosymbols(HTAB *hash, FILE *ofp, int flag, void (*op)(SYM *, FILE *f))
 {
-	int i;
-	for (i = 0; i < NHASH; i++) {
+	unsigned i;
+	if (hash->h_tab == NULL)
+		return;
+	for (i = 0; i <= hash->h_mask; i++) {
 		SYM *s;
-		for (s = hash[i]; s != NULL; s = s->s_fp) {
+		for (s = hash->h_tab[i]; s != NULL; s = s->s_fp) {
 			int t = s->s_type & TMMODE;
 			int n;
 			if (t != TUSER && t != TNEW)
@@ -421,19 +423,19 @@ static void dosymbols(SYM *hash[], FILE *ofp, int flag, void (*op)(SYM *, FILE *
 	}
 }
 
-static void writesymbols(SYM *hash[], FILE *ofp)
+static void writesymbols(HTAB *hash, FILE *ofp)
 {
 	fseek(ofp, obh.o_symbase, SEEK_SET);
 	dosymbols(hash, ofp, 1, putsymbol);
 	obh.o_dbgbase = ftell(ofp);
 	if (debug_write) {
-		dosymbols(uhash, ofp, 0, putsymbol);
+		dosymbols(&uhash, ofp, 0, putsymbol);
 	}
 }
 
 static void numbersymbols(void)
 {
-	dosymbols(uhash, NULL, 1, enumerate);
+	dosymbols(&uhash, NULL, 1, enumerate);
 }
 
 /*
@@ -460,7 +462,7 @@ void outeof(void)
 		outbyte(REL_ESC);
 		outbyte(REL_EOF);
 	}
-	writesymbols(uhash, ofp);
+	writesymbols(&uhash, ofp);
 	rewind(ofp);
 	obh.o_magic = MAGIC_OBJ;
 	fwrite(&obh, sizeof(obh), 1, ofp);
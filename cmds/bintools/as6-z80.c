@@ -194,13 +194,11 @@ SYM	sym[] = {
 void syminit(void)
 {
 	SYM *sp;
-	int hash;
 
 	sp = &sym[0];
 	while (sp < &sym[sizeof(sym)/sizeof(SYM)]) {
-		hash = symhash(sp->s_id);
-		sp->s_fp = phash[hash];
-		phash[hash] = sp;
+		sp->s_hash = symhash(sp->s_id);
+		syminsert(&phash, sp);
 		++sp;
 	}
 }
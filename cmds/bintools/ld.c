@@ -28,11 +28,9 @@
  *		symbols or relocations are left
  *
  *	There are a few things not yet addressed
- *	1.	For speed libraries can start with an _RANLIB ar file node which
- *		is an index of all the symbols by library module for speed.
- *	2.	Testing bigendian support.
- *	3.	Banked binaries (segments 5-7 ?).
- *	4.	Use typedefs and the like to support 32bit as well as 16bit
+ *	1.	Testing bigendian support.
+ *	2.	Banked binaries (segments 5-7 ?).
+ *	3.	Use typedefs and the like to support 32bit as well as 16bit
  *		addresses when built on bigger machines..
  */
 
@@ -59,7 +57,9 @@ static char *arg0;			/* Command name */
 static struct object *processing;	/* Object being processed */
 static const char *libentry;		/* Library entry name if relevant */
 static struct object *objects, *otail;	/* List of objects */
-static struct symbol *symhash[NHASH];	/* Symbol has tables */
+static struct symbol **symhash;	/* Symbol hash table */
+static unsigned hmask;			/* Size of table - 1 */
+static unsigned nsym;			/* Symbols in the table */
 static uint16_t base[OSEG];		/* Base of each segment */
 static uint16_t size[OSEG];		/* Size of each segment */
 static uint16_t align = 1;		/* Alignment */
@@ -333,25 +333,65 @@ static void free_object(struct object *o)
  *	Add a symbol to our symbol tables as we discover it. Log the
  *	fact if tracing.
  */
-struct symbol *new_symbol(const char *name, int hash)
+/*
+ *	Grow the hash table as the symbol count goes up so that the chains
+ *	stay short on big links. If we can't get the memory we just live
+ *	with longer chains.
+ */
+static void grow_symbols(void)
+{
+	unsigned n = symhash ? (hmask + 1) * 2 : NHASH;
+	struct symbol **t = calloc(n, sizeof(struct symbol *));
+	struct symbol *s, *sn;
+	unsigned i;
+
+	if (t == NULL) {
+		if (symhash == NULL)
+			error("out of memory");
+		return;
+	}
+	if (symhash) {
+		for (i = 0; i <= hmask; i++) {
+			for (s = symhash[i]; s != NULL; s = sn) {
+				sn = s->next;
+				s->next = t[s->hash & (n - 1)];
+				t[s->hash & (n - 1)] = s;
+			}
+		}
+		free(symhash);
+	}
+	symhash = t;
+	hmask = n - 1;
+}
+
+struct symbol *new_symbol(const char *name, uint16_t hash)
 {
 	struct symbol *s = xmalloc(sizeof(struct symbol));
 	strncpy(s->name, name, NAMELEN);
-	s->next = symhash[hash];
-	symhash[hash] = s;
+	s->hash = hash;
+	if (nsym++ >= 2 * hmask)
+		grow_symbols();
+	s->next = symhash[hash & hmask];
+	symhash[hash & hmask] = s;
 	if (verbose)
 		printf("+%.*s\n", NAMELEN, name);
 	return s;
 }
 
 /*
- *	Find a symbol in a given has table	
+ *	Find a symbol in the hash table. There is only ever one instance of
+ *	each name so the full hash is compared first and the string compare
+ *	is almost always a match.
  */
-struct symbol *find_symbol(const char *name, int hash)
+struct symbol *find_symbol(const char *name, uint16_t hash)
 {
-	struct symbol *s = symhash[hash];
+	struct symbol *s;
+
+	if (symhash == NULL)
+		return NULL;
+	s = symhash[hash & hmask];
 	while (s) {
-		if (strncmp(s->name, name, NAMELEN) == 0)
+		if (s->hash == hash && strncmp(s->name, name, NAMELEN) == 0)
 			return s;
 		s = s->next;
 	}
@@ -359,17 +399,17 @@ struct symbol *find_symbol(const char *name, int hash)
 }
 
 /*
- *	A simple but adequate hashing algorithm. A better one would
- *	be worth it for performance.
+ *	The "times 33 xor" string hash. Summing the characters clusters
+ *	badly on names like __mul16 and __mul32.
  */
-static uint8_t hash_symbol(const char *name)
+static uint16_t hash_symbol(const char *name)
 {
-	int hash = 0;
+	uint16_t hash = 5381;
 	uint8_t n = 0;
 
 	while(*name && n++ < NAMELEN)
-		hash += *name++;
-	return (hash&(NHASH-1));
+		hash = ((hash << 5) + hash) ^ (uint8_t)*name++;
+	return hash;
 }
 
 /*
@@ -378,7 +418,7 @@ static uint8_t hash_symbol(const char *name)
  */
 static int is_undefined(const char *name)
 {
-	int hash = hash_symbol(name);
+	uint16_t hash = hash_symbol(name);
 	struct symbol *s = find_symbol(name, hash);
 	if (s == NULL || !(s->type & S_UNKNOWN))
 		return 0;
@@ -422,7 +462,7 @@ static void segment_mismatch(struct symbol *s, uint8_t type2)
  */
 static struct symbol *find_alloc_symbol(struct object *o, uint8_t type, const char *id, uint16_t value)
 {
-	uint8_t hash = hash_symbol(id);
+	uint16_t hash = hash_symbol(id);
 	struct symbol *s = find_symbol(id, hash);
 
 	if (s == NULL) {
@@ -482,8 +522,8 @@ static void renumber_symbols(void)
 {
 	static int sym = 0;
 	struct symbol *s;
-	int i;
-	for (i = 0; i < NHASH; i++)
+	unsigned i;
+	for (i = 0; symhash && i <= hmask; i++)
 		for (s = symhash[i]; s != NULL; s=s->next)
 			if (s->type & (S_PUBLIC|S_UNKNOWN))
 				s->number = sym++;
@@ -493,8 +533,8 @@ static void renumber_symbols(void)
 static void write_symbols(FILE *fp)
 {
 	struct symbol *s;
-	int i;
-	for (i = 0; i < NHASH; i++) {
+	unsigned i;
+	for (i = 0; symhash && i <= hmask; i++) {
 		for (s = symhash[i]; s != NULL; s=s->next) {
 			fputc(s->type, fp);
 			fwrite(s->name, NAMELEN, 1, fp);
@@ -531,8 +571,8 @@ static void print_symbol(struct symbol *s, FILE *fp)
 static void write_map_file(FILE *fp)
 {
 	struct symbol *s;
-	int i;
-	for (i = 0; i < NHASH; i++) {
+	unsigned i;
+	for (i = 0; symhash && i <= hmask; i++) {
 		for (s = symhash[i]; s != NULL; s=s->next)
 			print_symbol(s, fp);
 	}
@@ -810,7 +850,7 @@ static void set_segment_bases(void)
 	/* At this point we have correctly relocated the base for each object. What
 	   we have yet to do is to relocate the symbols. Internal symbols are always
 	   created as absolute with no definedby */
-	for (i = 0; i < NHASH; i++) {
+	for (i = 0; symhash && i <= hmask; i++) {
 		struct symbol *s = symhash[i];
 		while (s != NULL) {
 			uint8_t seg = s->type & S_SEGMENT;
@@ -1278,6 +1318,42 @@ static void write_binary(FILE * op, FILE *mp)
  *	Scan through all the object modules in this ar archive and offer
  *	them to the linker.
  */
+/*
+ *	A library built with ar -s starts with a .RANLIB member listing the
+ *	symbols each module defines. The entries are in archive order so
+ *	walking it and loading the module for each symbol we still need picks
+ *	up the same modules in the same order as reading every member would.
+ */
+static void process_ranlib(const char *name, off_t pos, unsigned long size)
+{
+	static struct ar_hdr ah;
+	char sym[NAMELEN + 1];
+	struct symbol *s;
+	off_t end = pos + size;
+	off_t mpos;
+
+	sym[NAMELEN] = 0;
+	while (pos + RANLIB_ENTRYSIZE <= end) {
+		io_lseek(pos);
+		mpos = io_read16();
+		mpos |= (off_t)io_read16() << 16;
+		io_read(sym, NAMELEN);
+		pos += RANLIB_ENTRYSIZE;
+		/* Only bother with the module if we need the symbol */
+		s = find_symbol(sym, hash_symbol(sym));
+		if (s == NULL || !(s->type & S_UNKNOWN))
+			continue;
+		if (have_object(mpos + sizeof(ah), name))
+			continue;
+		io_lseek(mpos);
+		if (io_read(&ah, sizeof(ah)) != sizeof(ah))
+			error("bad library index");
+		libentry = ah.ar_name;
+		load_object(mpos + sizeof(ah), 1, name);
+	}
+	libentry = NULL;
+}
+
 static void process_library(const char *name)
 {
 	static struct ar_hdr ah;
@@ -1294,10 +1370,12 @@ static void process_library(const char *name)
 			break;
 		}
 		size = atol(ah.ar_size);
-#if 0 /* TODO */
-		if (strncmp(ah.ar_name, ".RANLIB", 8) == 0)
-			process_ranlib();
-#endif
+		/* The index is always the first member if present */
+		if (pos == SARMAG && strncmp(ah.ar_name, RANLIB_NAME " ",
+				sizeof(RANLIB_NAME)) == 0) {
+			process_ranlib(name, pos + sizeof(ah), size);
+			return;
+		}
 		libentry = ah.ar_name;
 		pos += sizeof(ah);
 		if (!have_object(pos, name))
@@ -1324,9 +1402,9 @@ static void add_object(const char *name, off_t off, int lib)
 		io_read(x, SARMAG);
 		if (memcmp(x, ARMAG, SARMAG) == 0) {
 			/* No it's a library. Do the library until a
-			   pass of the library resolves nothing. This isn't
-			   as fast as we'd like but we need ranlib support
-			   to do faster */
+			   pass of the library resolves nothing. With a
+			   ranlib index a pass only reads the modules we
+			   need */
 			do {
 				if (verbose)
 					printf(":: Library scan %s\n", name);
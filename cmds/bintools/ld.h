@@ -8,6 +8,7 @@ struct symbol
     char name[NAMELEN];
     uint16_t value;
     uint16_t number;	/* Needed when doing ld -r */
+    uint16_t hash;	/* Full hash of the name */
     uint8_t type;
     uint8_t flags;
 };
@@ -23,5 +24,5 @@ struct object {
     off_t off;		/* For libraries */
 };
 
-#define NHASH	64	/* Must be a power of 2 */
+#define NHASH	64	/* Initial size, must be a power of 2 */
 
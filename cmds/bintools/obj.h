@@ -163,6 +163,14 @@ struct objhdr
 
 #define S_ENTRYSIZE	(3 + NAMELEN)
 
+/* A library may start with a symbol index member built by ar -s. It holds
+   an entry for each symbol an object module in the library defines:
+    uint32_t offset of the member header in the archive (little endian)
+    char name[NAMELEN] (as in the symbol table) */
+
+#define RANLIB_NAME	".RANLIB"
+#define RANLIB_ENTRYSIZE	(4 + NAMELEN)
+
 /*
  * Segments
  */
@@ -109,6 +109,7 @@ char *xstrdup(const char *);
 
 extern void hash_init(void);
 extern unsigned memory_short(void);
+extern void memory_reserve(unsigned);
 extern char *set_entry(char *, struct define_item *, unsigned);
 extern struct define_item *read_entry(char *);
 extern void unlock_entry(struct define_item *);
@@ -358,6 +358,10 @@ static int get_onetok(int keep)
 				def_ptr = ptr->value;
 				def_start = 0;
 				ptr->flags |= F_INUSE;
+			} else {
+				/* Defined as nothing, so there is nothing to
+				   keep in memory either */
+				unlock_entry(ptr);
 			}
 			goto Try_again;
 		}
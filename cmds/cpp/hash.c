@@ -17,6 +17,11 @@
  *
  * void * read_entry(char * name);
  *        returns the value;
+ *
+ * Macro bodies stay in memory until we run short. When we do the least
+ * recently used half of them is paged out to a swap file which is only
+ * created the first time it is needed. A body never changes once it is
+ * defined so it only has to be written out once.
  */
 
 #define register
@@ -26,6 +31,7 @@ struct hashentry {
 	unsigned size;			/* Size */
 	struct define_item *d;		/* Block of data (NULL swapped) */
 	unsigned offset;		/* Offset on disk in 16 byte chunks */
+	unsigned used;			/* Last use for paging out */
 	char word[1];
 };
 
@@ -35,15 +41,39 @@ static struct hashentry *hashtable[HASHSIZE];
 int hashsize = 0xFF;		/* 2^X -1 */
 int hashcount = 0;
 
-static int swap_fd;
+static unsigned hashtick;
+static int swap_fd = -1;
 
-static void page_out(struct hashentry *h)
+static void swap_open(void)
 {
-	if (lseek(swap_fd, h->offset << 4, 0) < 0 ||
-		write(swap_fd, h->d, h->size) != h->size) {
-		cerror("swap error");
+	/* FIXME: name based on pid etc */
+	swap_fd = open(".cppswap", O_RDWR|O_CREAT|O_TRUNC, 0600);
+	if (swap_fd == -1) {
+		perror("swap");
 		exit(1);
 	}
+	unlink(".cppswap");
+}
+
+static unsigned page_next(void)
+{
+	return (lseek(swap_fd, 0L, SEEK_END) + 15) >> 4;
+}
+
+static void page_out(struct hashentry *h)
+{
+	if (h->offset == 0xFFFF) {
+		if (swap_fd == -1)
+			swap_open();
+		h->offset = page_next();
+		if (lseek(swap_fd, h->offset << 4, 0) < 0 ||
+			write(swap_fd, h->d, h->size) != h->size) {
+			cerror("swap error");
+			exit(1);
+		}
+	}
+	free(h->d);
+	h->d = NULL;
 }
 
 static void page_in(struct hashentry *h)
@@ -59,6 +89,21 @@ static void page_in(struct hashentry *h)
 
 static int hashvalue(char *word);
 
+static void mark_used(struct hashentry *h)
+{
+	struct hashentry **hp;
+	register struct hashentry *p;
+
+	/* Only the order matters so on wrap just start everyone again */
+	if (++hashtick == 0) {
+		for (hp = hashtable; hp < hashtable + HASHSIZE; hp++)
+			for (p = *hp; p; p = p->next)
+				p->used = 0;
+		hashtick = 1;
+	}
+	h->used = hashtick;
+}
+
 struct define_item *read_entry(char *word)
 {
 	unsigned hash_val;
@@ -74,6 +119,7 @@ struct define_item *read_entry(char *word)
 			continue;
 		if (hashline->d == NULL)
 			page_in(hashline);
+		mark_used(hashline);
 		hashline->d->flags |= F_BUSY;
 		return hashline->d;
 	}
@@ -104,6 +150,7 @@ char *set_entry(char *word, struct define_item *d, unsigned size)
 			hashline->d = d;
 			hashline->size = size;
 			hashline->offset = 0xFFFF;
+			mark_used(hashline);
 		} else {
 			if (prev == 0)
 				hashtable[hash_val] = hashline->next;
@@ -125,6 +172,7 @@ char *set_entry(char *word, struct define_item *d, unsigned size)
 	hashline->offset = 0xFFFF;
 	strcpy(hashline->word, word);
 	hashtable[hash_val] = hashline;
+	mark_used(hashline);
 	return hashline->word;
 }
 
@@ -140,45 +188,55 @@ static int hashvalue(char *word)
 	return val;
 }
 
-static unsigned page_next(void)
-{
-	return (lseek(swap_fd, 0L, SEEK_END) + 15) >> 4;
-}
+/* Bodies that are resident and not being expanded can be paged out */
+#define swappable(h)	((h)->d && !((h)->d->flags & (F_BUSY | F_INUSE)))
 
-static unsigned flush_nodes(struct hashentry *hp)
+unsigned memory_short(void)
 {
-	register struct hashentry *h = hp;
+	struct hashentry **hp;
+	register struct hashentry *h;
+	unsigned lo = 0xFFFF;
+	unsigned hi = 0;
 	unsigned n = 0;
-	while(h) {
-		if (h->d && !(h->d->flags & F_INUSE)) {
-			if (h->offset == 0xFFFF)
-				h->offset = page_next();
-			n++;
-			page_out(h);
-			free(h->d);
-			h->d = NULL;
+
+	for (hp = hashtable; hp < hashtable + HASHSIZE; hp++) {
+		for (h = *hp; h; h = h->next) {
+			if (swappable(h)) {
+				if (h->used < lo)
+					lo = h->used;
+				if (h->used > hi)
+					hi = h->used;
+				n++;
+			}
+		}
+	}
+	if (n == 0)
+		return 0;
+	/* Page out the least recently used half. If we are still short the
+	   caller will be back for more */
+	lo += (hi - lo) / 2;
+	n = 0;
+	for (hp = hashtable; hp < hashtable + HASHSIZE; hp++) {
+		for (h = *hp; h; h = h->next) {
+			if (swappable(h) && h->used <= lo) {
+				page_out(h);
+				n++;
+			}
 		}
-		h = h->next;
 	}
 	return n;
 }
 
-unsigned memory_short(void)
+/* Make sure there is space for something we can't retry such as the
+   buffer for a stdio stream */
+void memory_reserve(unsigned size)
 {
-	struct hashentry **h = hashtable;
-	unsigned n = 0;
-	while(h < hashtable + HASHSIZE)
-		n += flush_nodes(*h++);
-	return n;
+	void *p;
+	while ((p = malloc(size)) == NULL && memory_short());
+	free(p);
 }
 
 void hash_init(void)
 {
-	/* FIXME: name based on pid etc */
-	swap_fd = open(".cppswap", O_RDWR|O_CREAT|O_TRUNC, 0600);
-	if (swap_fd == -1) {
-		perror("swap");
-		exit(1);
-	}
-	unlink(".cppswap");
+	/* The swap file is opened when we first need it */
 }
@@ -232,7 +232,7 @@ FILE *open_include(char *fname, char *mode, int checkrel)
 #endif
 	char buf[256], *p;
 
-	memory_short();
+	memory_reserve(__stdio_bufmax + 64);
 	if (checkrel) {
 		strlcpy(buf, c_fname, 256);
 		p = strrchr(buf, '/');
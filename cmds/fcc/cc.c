@@ -221,6 +221,7 @@ const char *crtname = "crt0.o";
 
 int print_passes=0;
 int keep_temp;
+int pipe_passes;
 int last_phase = 4;
 int only_one_input;
 char *target;
@@ -463,11 +464,24 @@ static void resolve_libraries(void)
 	}
 }
 
-static void run_command(void)
+/*
+ *	Commands are started and then reaped as a group so that a chain of
+ *	passes joined by pipes can run at the same time. A single pass is
+ *	just a group of one.
+ */
+#define MAXPIPE	4
+
+static pid_t pidlist[MAXPIPE];
+static char *pidname[MAXPIPE];
+static int npid;
+
+/* Read end of a pipe waiting to become the input of the next command */
+static int pipein = -1;
+
+static void start_command(void)
 {
-	pid_t pid, p;
+	pid_t pid;
 	const char **ptr;
-	int status;
 
 	fflush(stdout);
 
@@ -497,30 +511,73 @@ static void run_command(void)
 			dup2(argoutfd, 1);
 			close(argoutfd);
 		}
+		/* Close the read end of our output pipe by hand. We can't
+		   leave it to close on exec as the emulators run an exec in
+		   the same process, and while we hold it we never see
+		   SIGPIPE should the pass after us give up */
+		if (pipein != -1)
+			close(pipein);
 		execv(arglist[0], (char **)arglist);
 		perror(arglist[0]);
 		exit(255);
 	}
-	if (arginfd)
+	if (arginfd != -1)
 		close(arginfd);
-	if (argoutfd)
+	if (argoutfd != -1)
 		close(argoutfd);
-	while ((p = waitpid(pid, &status, 0)) != pid) {
-		if (p == -1) {
-			perror("waitpid");
-			fatal();
+	pidlist[npid] = pid;
+	pidname[npid] = xstrdup((char *)arglist[0], 0);
+	npid++;
+}
+
+static void died(int n, int status)
+{
+	fprintf(stderr, "cc: %s failed with signal %d.\n", pidname[n],
+		WTERMSIG(status));
+	fatal();
+}
+
+static void wait_commands(void)
+{
+	pid_t p;
+	int status[MAXPIPE];
+	int i, bad = -1;
+
+	for (i = 0; i < npid; i++) {
+		while ((p = waitpid(pidlist[i], &status[i], 0)) != pidlist[i]) {
+			if (p == -1) {
+				perror("waitpid");
+				fatal();
+			}
 		}
 	}
-	if (WIFSIGNALED(status)) {
-		/* Scream loudly if it exploded */
-		fprintf(stderr, "cc: %s failed with signal %d.\n", arglist[0],
-			WTERMSIG(status));
-		fatal();
+	/* Scream loudly if something exploded. Anything upstream of it in a
+	   pipe will usually have died of SIGPIPE as a result so look past
+	   those first */
+	for (i = 0; i < npid; i++) {
+		if (WIFSIGNALED(status[i]) && (bad == -1 ||
+				WTERMSIG(status[bad]) == SIGPIPE))
+			bad = i;
 	}
-	/* Quietly exit if the stage errors. That means it has reported
+	if (bad != -1 && WTERMSIG(status[bad]) != SIGPIPE)
+		died(bad, status[bad]);
+	/* Quietly exit if a stage errors. That means it has reported
 	   things to the user */
-	if (WEXITSTATUS(status))
-		fatal();
+	for (i = 0; i < npid; i++) {
+		if (!WIFSIGNALED(status[i]) && WEXITSTATUS(status[i]))
+			fatal();
+	}
+	if (bad != -1)
+		died(bad, status[bad]);
+	for (i = 0; i < npid; i++)
+		free(pidname[i]);
+	npid = 0;
+}
+
+static void run_command(void)
+{
+	start_command();
+	wait_commands();
 }
 
 static void redirect_in(const char *p)
@@ -549,10 +606,32 @@ static void redirect_out(const char *p)
 #endif
 }
 
+/*
+ *	Send the output of the command being built into a pipe. The read end
+ *	becomes the input of the next command built. start_command() keeps
+ *	the ends each child isn't using out of it.
+ */
+static void redirect_pipe(void)
+{
+	int fd[2];
+
+	if (pipe(fd) == -1) {
+		perror("pipe");
+		fatal();
+	}
+	argoutfd = fd[1];
+	pipein = fd[0];
+#ifdef DEBUG
+	if (print_passes)
+		printf("|\n");
+#endif
+}
+
 static void build_arglist(char *p)
 {
-	arginfd = -1;
+	arginfd = pipein;
 	argoutfd = -1;
+	pipein = -1;
 	argptr = arglist;
 	add_argument(p);
 }
@@ -569,6 +648,21 @@ void convert_s_to_o(char *path)
 	free(origpath);
 }
 
+static void cc2_arglist(char *optstr, char *featstr)
+{
+	build_arglist(make_lib_name("cc2", cpudot));
+	add_argument(symtab);
+	add_argument(cpucode);
+	/* FIXME: need to change backend.c parsing for above and also
+	   add another arg when we do the new subcpu bits like -banked */
+	optstr[0] = optimize;
+	optstr[1] = '\0';
+	add_argument(optstr);
+	add_argument(featstr);
+	if (codeseg)
+		add_argument(codeseg);
+}
+
 void convert_c_to_s(char *path)
 {
 	char *tmp, *t, *p;
@@ -597,17 +691,7 @@ void convert_c_to_s(char *path)
 	redirect_out(tmp);
 	run_command();
 
-	build_arglist(make_lib_name("cc2", cpudot));
-	add_argument(symtab);
-	add_argument(cpucode);
-	/* FIXME: need to change backend.c parsing for above and also
-	   add another arg when we do the new subcpu bits like -banked */
-	optstr[0] = optimize;
-	optstr[1] = '\0';
-	add_argument(optstr);
-	add_argument(featstr);
-	if (codeseg)
-		add_argument(codeseg);
+	cc2_arglist(optstr, featstr);
 	redirect_in(tmp);
 	if (optimize == '0') {
 		redirect_out(pathmod(path, ".#", ".s", 2, 2));
@@ -630,6 +714,64 @@ void convert_c_to_s(char *path)
 	free(p);
 }
 
+/*
+ *	With --pipe the passes are chained together instead of going via
+ *	scratch files. cc2 reads the symbol table as it starts and cc0 only
+ *	writes it at the end so the work is split into two pipelines either
+ *	side of the one remaining scratch file.
+ *
+ *	cpp $1.c | cc0 | cc1 >$1.#
+ *	cc2 <$1.# | copt >$1.s
+ */
+void pipe_c_to_s(char *path)
+{
+	char *tmp, *p;
+	char optstr[2];
+	char featstr[16];
+
+	snprintf(featstr, 16, "%lu", features);
+
+	build_arglist(make_lib_name("cpp", ""));
+	add_argument_list("-I", &inclist);
+	add_argument_list("-D", &deflist);
+	add_argument("-E");
+	add_argument(path);
+	redirect_pipe();
+	start_command();
+
+	build_arglist(make_lib_name("cc0", ""));
+	add_argument(symtab);
+	redirect_pipe();
+	start_command();
+
+	build_arglist(make_lib_name("cc1", cpudot));
+	add_argument(cpucode);
+	add_argument(featstr);
+	tmp = pathmod(path, ".c", ".#", 0, 255);
+	redirect_out(tmp);
+	start_command();
+	wait_commands();
+
+	cc2_arglist(optstr, featstr);
+	redirect_in(tmp);
+	if (optimize == '0') {
+		redirect_out(pathmod(path, ".#", ".s", 2, 2));
+		run_command();
+		return;
+	}
+	redirect_pipe();
+	start_command();
+
+	/* TODO: with the new copt we may end up with a copt per cpu */
+	p = xstrdup(make_lib_name("copt", ""), 0);
+	build_arglist(p);
+	add_argument(make_lib_name("rules.", cpuset));
+	redirect_out(pathmod(path, ".#", ".s", 2, 2));
+	start_command();
+	wait_commands();
+	free(p);
+}
+
 void convert_S_to_s(char *path)
 {
 	char *tmp;
@@ -761,6 +903,11 @@ void sequence(struct obj *i)
 		i->type = TYPE_s;
 		i->used = 1;
 	}
+	if (i->type == TYPE_C && pipe_passes && last_phase != 1) {
+		pipe_c_to_s(i->name);
+		i->type = TYPE_s;
+		i->used = 1;
+	}
 	if (i->type == TYPE_C) {
 		preprocess_c(i->name);
 		i->type = TYPE_C_pp;
@@ -784,14 +931,107 @@ void sequence(struct obj *i)
 	}
 }
 
+/*
+ *	With -j each input is run through sequence() by a child of its own so
+ *	that up to jobs of them are in flight at once. The child has its own
+ *	symbol table and cleans up its own scratch files. All the parent has
+ *	to do is catch up with the changes sequence() made to the object so
+ *	the link sees the .o files in the right order.
+ */
+#define MAXJOBS	32
+
+int jobs = 1;
+static pid_t jobpid[MAXJOBS];
+static struct obj *jobobj[MAXJOBS];
+static int njobs;
+static int jobfail;
+
+static void sequence_job(struct obj *i)
+{
+	symtab = xstrdup(".symtmp", 6);
+	snprintf(symtab + 7, 6, "%x", getpid());
+	sequence(i);
+	remove_temporaries();
+	if (keep_temp == 0)
+		unlink(symtab);
+	exit(0);
+}
+
+static void sequence_done(struct obj *i)
+{
+	if (i->type != TYPE_S && i->type != TYPE_C && i->type != TYPE_s)
+		return;
+	i->used = 1;
+	if (last_phase < 3)
+		return;
+	/* Same length as the .c/.s/.S so this is safe */
+	strcpy(strrchr(i->name, '.'), ".o");
+	i->type = TYPE_O;
+}
+
+static void reap_job(void)
+{
+	pid_t p;
+	int status, n;
+
+	p = wait(&status);
+	if (p == -1) {
+		perror("wait");
+		fatal();
+	}
+	for (n = 0; n < njobs; n++)
+		if (jobpid[n] == p)
+			break;
+	if (n == njobs)
+		return;
+	if (WIFSIGNALED(status)) {
+		fprintf(stderr, "cc: %s failed with signal %d.\n",
+			jobobj[n]->name, WTERMSIG(status));
+		jobfail = 1;
+	} else if (WEXITSTATUS(status))
+		jobfail = 1;
+	else
+		sequence_done(jobobj[n]);
+	njobs--;
+	jobpid[n] = jobpid[njobs];
+	jobobj[n] = jobobj[njobs];
+}
+
+static void start_job(struct obj *i)
+{
+	pid_t pid;
+
+	while (njobs == jobs)
+		reap_job();
+	fflush(stdout);
+	pid = fork();
+	if (pid == -1) {
+		perror("fork");
+		fatal();
+	}
+	if (pid == 0)
+		sequence_job(i);
+	jobpid[njobs] = pid;
+	jobobj[njobs] = i;
+	njobs++;
+}
+
 void processing_loop(void)
 {
 	struct obj *i = objlist.head;
-	while (i) {
-		sequence(i);
-		remove_temporaries();
+	while (i && !jobfail) {
+		if (jobs > 1)
+			start_job(i);
+		else {
+			sequence(i);
+			remove_temporaries();
+		}
 		i = i->next;
 	}
+	while (njobs)
+		reap_job();
+	if (jobfail)
+		fatal();
 	if (last_phase < 4)
 		return;
 	link_phase();
@@ -916,6 +1156,10 @@ void extended_opt(const char *p)
 		crtname = "lib0.o";
 		return;
 	}
+	if (strcmp(p, "pipe") == 0) {
+		pipe_passes = 1;
+		return;
+	}
 	usage();
 }
 
@@ -1021,6 +1265,19 @@ int main(int argc, char *argv[]) {
 		case 's':	/* FIXME: for now - switch to getopt */
 			standalone = 1;
 			break;
+		case 'j':
+			if ((*p)[2])
+				jobs = atoi(*p + 2);
+			else if (p[1])
+				jobs = atoi(*++p);
+			else
+				usage();
+			if (jobs < 1 || jobs > MAXJOBS) {
+				fprintf(stderr, "cc: -j must be 1 to %d.\n",
+					MAXJOBS);
+				fatal();
+			}
+			break;
 		case 'V':
 			print_passes = 1;
 			break;
@@ -1080,6 +1337,11 @@ int main(int argc, char *argv[]) {
 	if (only_one_input && c_files > 1)
 		one_input();
 
+	/* -E writes to stdout, so jobs running side by side would mix
+	   their output together */
+	if (last_phase == 1)
+		jobs = 1;
+
 	symtab = xstrdup(".symtmp", 6);
 	snprintf(symtab + 7, 6, "%x", getpid());
 	processing_loop();
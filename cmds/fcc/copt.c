@@ -10,6 +10,7 @@
 int rpn_eval(const char* expr, char** vars);
 
 #define HSIZE 107
+#define RHSIZE 61
 #define MAXLINE 128
 #define MAXFIRECOUNT 65535L
 #define MAX_PASS 16
@@ -31,8 +32,17 @@ struct onode {
     struct lnode *o_old, *o_new;
     struct onode* o_next;
     long firecount;
+    char* o_key; /* literal opcode of the last pattern line, or 0 */
+    struct onode* o_hnext; /* next rule in the same index chain */
+    int o_seq; /* position in opts */
 }* opts = 0, *activerule = 0;
 
+/* Rules indexed by the opcode of their last pattern line, which is
+   the first one matched. Rules whose last line does not start with
+   a literal opcode are kept on rwild and tried against every line. */
+struct onode* rhash[RHSIZE];
+struct onode* rwild;
+
 void printlines(struct lnode* beg, struct lnode* end, FILE* out)
 {
     struct lnode* p;
@@ -400,16 +410,103 @@ struct lnode* copylist(
     return more;
 }
 
+/* opcode - find the opcode of line s. Returns its length and sets
+   *start, or returns -1 if the opcode is not literal text */
+int opcode(char* s, char** start)
+{
+    char* p;
+
+    while (*s == ' ' || *s == '\t')
+        s++;
+    *start = s;
+    for (p = s; *p && !isspace((unsigned char)*p); p++)
+        if (*p == '%')
+            return -1;
+    return p - s;
+}
+
+int rhashfn(char* s, int len)
+{
+    unsigned h = 0;
+
+    while (len--)
+        h = h * 31 + (unsigned char)*s++;
+    return h % RHSIZE;
+}
+
+/* index_rules - rebuild the rule index from opts, keeping rule order */
+void index_rules(void)
+{
+    struct onode *o, **tail[RHSIZE], **wtail;
+    char *s, lin[MAXLINE];
+    int i, len;
+
+    for (i = 0; i < RHSIZE; i++) {
+        rhash[i] = 0;
+        tail[i] = &rhash[i];
+    }
+    rwild = 0;
+    wtail = &rwild;
+
+    for (o = opts, i = 0; o; o = o->o_next, i++) {
+        o->o_seq = i;
+        o->o_hnext = 0;
+        o->o_key = 0;
+        len = -1;
+        if (o->o_old && strncmp(o->o_old->l_text, "%check", 6) != 0
+            && strncmp(o->o_old->l_text, "%eval", 5) != 0)
+            len = opcode(o->o_old->l_text, &s);
+        if (len < 0) {
+            *wtail = o;
+            wtail = &o->o_hnext;
+            continue;
+        }
+        memcpy(lin, s, len);
+        lin[len] = 0;
+        o->o_key = install(lin);
+        len = rhashfn(s, len);
+        *tail[len] = o;
+        tail[len] = &o->o_hnext;
+    }
+}
+
 /* opt - replace instructions ending at r if possible */
 struct lnode* opt(struct lnode* r)
 {
     char* vars[10];
-    int i, lines;
+    int i, lines, len;
     struct lnode *c, *p;
-    struct onode* o;
+    struct onode *o, *h, *w;
+    char* s;
+    int linear = 0;
     static char* activated = "%activated ";
 
-    for (o = opts; o; o = o->o_next) {
+    /* Only the rules filed under this line's opcode and the wildcard
+       rules can match. Walk both chains together in rule order. */
+    h = 0;
+    len = opcode(r->l_text, &s);
+    if (len >= 0)
+        h = rhash[rhashfn(s, len)];
+    w = rwild;
+    o = 0;
+
+    for (;;) {
+        if (linear)
+            o = o->o_next;
+        else {
+            while (h && (strncmp(h->o_key, s, len) || h->o_key[len]))
+                h = h->o_hnext;
+            if (h && (!w || h->o_seq < w->o_seq)) {
+                o = h;
+                h = h->o_hnext;
+            } else {
+                o = w;
+                if (w)
+                    w = w->o_hnext;
+            }
+        }
+        if (!o)
+            break;
         activerule = o;
         if (o->firecount < 1)
             continue;
@@ -513,6 +610,11 @@ struct lnode* opt(struct lnode* r)
             while (--lines && r->l_prev)
                 r = r->l_prev;
             global_again = 1; /* signalize changes */
+
+            /* r has moved and there are new rules, so try the rest
+               of them in order and index the new ones */
+            index_rules();
+            linear = 1;
             continue;
         }
 
@@ -546,6 +648,7 @@ int main(int argc, char** argv)
     getlst(stdin, "", &head, &tail);
 
     head.l_text = tail.l_text = "";
+    index_rules();
 
     pass = 0;
     do {
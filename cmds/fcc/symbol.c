@@ -3,6 +3,11 @@
  *	local. To avoid two lists we keep a "last local" and "last global"
  *	pointer. This allows us to keep dumping local names whilst still
  *	being able to defines globals in local contexts.
+ *
+ *	Named symbols are also chained by a hash of the name so that a lookup
+ *	only looks at symbols that might match. The chains are in no
+ *	particular order so the lookups pick between matches by position in
+ *	the table, which is what gives the scoping rules.
  */
 
 #include <stdio.h>
@@ -16,6 +21,32 @@ struct symbol symtab[MAXSYM];
 struct symbol *last_sym = symtab - 1;
 struct symbol *local_top = symtab;
 
+#define NSYMHASH	128
+#define SYMHASH(n)	((n) & (NSYMHASH - 1))
+#define NONAME		0xFFFF	/* Type slots, never looked up by name */
+
+static struct symbol *symhash[NSYMHASH];
+static struct symbol *symnext[MAXSYM];
+
+static void hash_symbol(struct symbol *s)
+{
+	struct symbol **h = symhash + SYMHASH(s->name);
+	symnext[s - symtab] = *h;
+	*h = s;
+}
+
+static void unhash_symbol(struct symbol *s)
+{
+	struct symbol **h = symhash + SYMHASH(s->name);
+	while (*h) {
+		if (*h == s) {
+			*h = symnext[s - symtab];
+			return;
+		}
+		h = symnext + (*h - symtab);
+	}
+}
+
 struct symbol *symbol_ref(unsigned type)
 {
 	return symtab + INFO(type);
@@ -25,38 +56,44 @@ struct symbol *symbol_ref(unsigned type)
 /* Find a symbol in the normal name space */
 struct symbol *find_symbol(unsigned name, unsigned global)
 {
-	struct symbol *s = last_sym;
+	struct symbol *s = symhash[SYMHASH(name)];
+	struct symbol *lmatch = NULL;
 	struct symbol *gmatch = NULL;
-	/* Walk backwards so that the first local we find is highest priority
-	   by scope */
-	while (s >= symtab) {
+	/* The highest local is highest priority by scope, failing that the
+	   lowest global */
+	while (s) {
 		if (s->name == name && s->infonext < S_TYPEDEF) {
 			if (s->infonext < S_STATIC) {
-				if (!global)
-					return s;
-			} else	/* Still need to look for a local */
+				if (!global && (lmatch == NULL || s > lmatch))
+					lmatch = s;
+			} else if (gmatch == NULL || s < gmatch)
 				gmatch = s;
 		}
-		s--;
+		s = symnext[s - symtab];
 	}
+	if (lmatch)
+		return lmatch;
 	return gmatch;
 }
 
 struct symbol *find_symbol_by_class(unsigned name, unsigned class)
 {
-	struct symbol *s = last_sym;
+	struct symbol *s = symhash[SYMHASH(name)];
+	struct symbol *lmatch = NULL;
 	struct symbol *gmatch = NULL;
-	/* Walk backwards so that the first local we find is highest priority
-	   by scope */
-	while (s >= symtab) {
+	/* As above */
+	while (s) {
 		if (s->name == name && S_STORAGE(s->infonext) == class) {
-			if (s->infonext < S_STATIC)
-				return s;
-			else	/* Still need to look for a local */
+			if (s->infonext < S_STATIC) {
+				if (lmatch == NULL || s > lmatch)
+					lmatch = s;
+			} else if (gmatch == NULL || s < gmatch)
 				gmatch = s;
 		}
-		s--;
+		s = symnext[s - symtab];
 	}
+	if (lmatch)
+		return lmatch;
 	return gmatch;
 }
 
@@ -67,6 +104,7 @@ void pop_local_symbols(struct symbol *top)
 		if (S_STORAGE(s->infonext) < S_STATIC) {
 			/* Write out any storage if needed */
 			symbol_bss(s);
+			unhash_symbol(s);
 			s->infonext = S_FREE;
 			s->name = 0;
 		}
@@ -86,14 +124,19 @@ struct symbol *mark_local_symbols(void)
 struct symbol *alloc_symbol(unsigned name, unsigned local)
 {
 	struct symbol *s = local_top;
-	while (s <= &symtab[MAXSYM]) {
+	while (s < &symtab[MAXSYM]) {
 		if (s->infonext == S_FREE) {
 			if (local && local_top < s)
 				local_top = s;
 			if (last_sym < s)
 				last_sym = s;
+			/* A slot can be left free but still named if a
+			   declaration failed */
+			unhash_symbol(s);
 			s->name = name;
 			s->data.idx = 0;
+			if (name != NONAME)
+				hash_symbol(s);
 			return s;
 		}
 		s++;
@@ -202,7 +245,7 @@ static struct symbol *do_type_match(unsigned st, unsigned rtype, unsigned *idx)
 		}
 		sym++;
 	}
-	sym = alloc_symbol(0xFFFF, 0);
+	sym = alloc_symbol(NONAME, 0);
 	sym->infonext = st;
 	sym->data.idx = idx;
 	sym->type = rtype;
@@ -317,19 +360,21 @@ unsigned array_compatible(unsigned t1, unsigned t2)
 
 static struct symbol *find_struct(unsigned name)
 {
-	struct symbol *sym = symtab;
+	struct symbol *sym = symhash[SYMHASH(name)];
+	struct symbol *match = NULL;
 	/* Anonymous structs are unique each time */
 	if (name == 0)
 		return 0;
-	while(sym <= last_sym) {
-		if (sym->name == name) {
+	/* The first one declared */
+	while(sym) {
+		if (sym->name == name && (match == NULL || sym < match)) {
 			unsigned st = S_STORAGE(sym->infonext);
 			if (st == S_STRUCT || st == S_UNION)
-				return sym;
+				match = sym;
 		}
-		sym++;
+		sym = symnext[sym - symtab];
 	}
-	return NULL;
+	return match;
 }
 
 struct symbol *update_struct(unsigned name, unsigned t)
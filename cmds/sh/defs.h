@@ -71,6 +71,7 @@
 #define SYSREAD 17
 #define SYSTST	18
 #define	SYSUMASK	19
+#define SYSHASH	20
 
 /* used for input and output of shell */
 #if 0 /* V7 */
@@ -372,6 +373,9 @@ extern void initio(IOPTR iop);
 extern const char *getpath(const char *s);
 extern int pathopen(const char *path, const char *name);
 extern const char *catpath(register const char *path, const char *name);
+extern const char *hashcmd(const char *name);
+extern void zaphash(int all);
+extern void prhash(void);
 extern void execa(const char **at);
 extern void postclr(void);
 extern void post(int pcsid);
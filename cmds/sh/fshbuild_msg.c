@@ -116,5 +116,6 @@ SYSTAB commands = {
 	{"exec", SYSEXEC},
 	{"times", SYSTIMES},
 	{"umask", SYSUMASK},
+	{"hash", SYSHASH},
 	{0, 0},
 };
@@ -160,6 +160,8 @@ int execute(TREPTR argt, int execflg, int *pf1, int *pf2)
 							failed(com[0], restricted);
 						else if ((a1 == 0 && (a1 = (char *)homenod.namval) == 0) || chdir(a1) < 0) /* FIXME */
 							failed(a1, baddir);
+						else
+							zaphash(0);
 						break;
 
 					case SYSSHFT:
@@ -234,6 +236,24 @@ int execute(TREPTR argt, int execflg, int *pf1, int *pf2)
 						}
 						break;
 
+					case SYSHASH:
+						if (a1 == 0)
+							prhash();
+						else if (eq(a1, "-r"))
+							zaphash(1);
+						else {
+							while (*++com) {
+								if (hashcmd(*com) == 0) {
+									prs(*com);
+									prs(colon);
+									prs(notfound);
+									newline();
+									exitval = 1;
+								}
+							}
+						}
+						break;
+
 					default:
 						internal = builtin(argn, com);
 
@@ -245,6 +265,8 @@ int execute(TREPTR argt, int execflg, int *pf1, int *pf2)
 						chktrap();
 						break;
 					}
+					/* look it up here so the answer is kept */
+					hashcmd(com[0]);
 				} else if (t->treio == 0)
 					break;
 			}
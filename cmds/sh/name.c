@@ -102,8 +102,11 @@ void assign(NAMPTR n, const char *v)
 {
 	if (n->namflg & N_RDONLY)
 		failed(n->namid, wtfailed);
-	else
+	else {
 		replace((char **)&n->namval, v);	/* FIXME: check safe */
+		if (n == &pathnod)
+			zaphash(1);
+	}
 }
 
 int readvar(char **names)
@@ -12,6 +12,7 @@
 
 #include	"defs.h"
 #include <string.h>
+#include <sys/stat.h>
 
 
 static const char *execs(const char *ap, const char *t[]);
@@ -118,6 +119,97 @@ const char *catpath(register const char *path, const char *name)
 	return (path);
 }
 
+/* remembered command locations */
+#define NCMDHASH	16
+
+struct cmdent {
+	struct cmdent *cmdnxt;
+	char *cmddir;		/* PATH component it was found in */
+	char cmdnam[1];
+};
+
+static struct cmdent *cmdtab[NCMDHASH];
+
+static struct cmdent **cmdfind(register const char *name)
+{
+	register struct cmdent **hp;
+	register unsigned h = 0;
+	const char *s = name;
+
+	while (*s)
+		h = (h << 1) + *s++;
+	hp = &cmdtab[h & (NCMDHASH - 1)];
+	while (*hp && !eq((*hp)->cmdnam, name))
+		hp = &(*hp)->cmdnxt;
+	return (hp);
+}
+
+const char *hashcmd(const char *name)
+{
+	/* directory to run name from, searching PATH if we don't know */
+	register const char *path, *next;
+	register struct cmdent *h;
+	struct cmdent **hp;
+	struct stat st;
+	int n;
+
+	if (any('/', name))
+		return (0);
+	hp = cmdfind(name);
+	if (*hp)
+		return ((*hp)->cmddir);
+	if ((path = pathnod.namval) == 0)
+		path = defpath;
+	do {
+		next = catpath(path, name);
+		if (stat(curstak(), &st) == 0 && S_ISREG(st.st_mode)
+		    && (st.st_mode & 0111)) {
+			n = (next ? next - 1 : path + length(path) - 1) - path;
+			h = (struct cmdent *)alloc(sizeof(struct cmdent) + length(name) + n);
+			h->cmddir = movstr(name, h->cmdnam) + 1;
+			memcpy(h->cmddir, path, n);
+			h->cmddir[n] = 0;
+			h->cmdnxt = 0;
+			return ((*hp = h)->cmddir);
+		}
+	} while ((path = next));
+	return (0);
+}
+
+void zaphash(int all)
+{
+	/* forget everything, or just what depends on the current directory */
+	register struct cmdent **hp, *h;
+	int i;
+
+	for (i = 0; i < NCMDHASH; i++) {
+		hp = &cmdtab[i];
+		while ((h = *hp)) {
+			if (all || *h->cmddir != '/') {
+				*hp = h->cmdnxt;
+				sh_free(h);
+			} else
+				hp = &h->cmdnxt;
+		}
+	}
+}
+
+void prhash(void)
+{
+	register struct cmdent **hp, *h;
+
+	for (hp = cmdtab; hp < &cmdtab[NCMDHASH]; hp++) {
+		for (h = *hp; h; h = h->cmdnxt) {
+			if (*h->cmddir) {
+				prs(h->cmddir);
+				prc('/');
+			}
+			prs(h->cmdnam);
+			newline();
+		}
+	}
+}
+
 static const char *xecmsg;
 static char **xecenv;
 
@@ -125,12 +217,17 @@ void execa(const char **at)
 {
 	register const char *path;
 	register const char **t = at;
+	struct cmdent *h;
 
 	if ((flags & noexec) == 0) {
 		xecmsg = notfound;
 		path = getpath(*t);
+		h = any('/', *t) ? 0 : *cmdfind(*t);
 		namscan(exname);
 		xecenv = sh_setenv();
+		/* if it has moved since we found it fall back to a search */
+		if (h)
+			execs(h->cmddir, t);
 		while ( (path = execs(path, t)) );
 		failed(*t, xecmsg);
 	}
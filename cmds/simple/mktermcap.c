@@ -0,0 +1,286 @@
+/*
+ *	mktermcap - compile a termcap file into the indexed form that
+ *	tgetent() looks in before reading the text file (see libs/tgetent.c)
+ *
+ *	mktermcap [termcap [database]]
+ *
+ *	The defaults are /etc/termcap and /etc/termcap.db. Continuation
+ *	lines are joined and tc= references expanded, so each terminal
+ *	becomes one record that tgetent can read straight into its buffer.
+ *	It only uses stdio so it also builds on the host, for making the
+ *	database for a FUZIXROOT tree. tgetent ignores the database once
+ *	/etc/termcap is newer than it, so rerun this after editing.
+ *
+ *	Layout, all numbers 16bit little endian:
+ *		"tcb1" nbucket bucket[nbucket]
+ *		name records: next entry len name[len]
+ *		entries: len text (len includes the terminating NUL)
+ *	A bucket holds the offset of its first name record, or 0. Names
+ *	hash with h = h * 33 + c in 16 bits.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define TCDB_MAGIC	"tcb1"
+#define MAXENT		1024	/* Size of the tgetent() buffer */
+#define MAXTC		16	/* Depth of tc= chains we follow */
+
+struct name {
+	char *name;
+	unsigned int len;
+	unsigned int entry;
+	unsigned int hash;
+	unsigned int offset;
+};
+
+static char **ent;
+static unsigned int nent;
+static struct name *names;
+static unsigned int nnames;
+static unsigned int *entoff;
+static const char *progname = "mktermcap";
+
+static void fatal(const char *msg, const char *arg)
+{
+	fprintf(stderr, "%s: %s%s\n", progname, msg, arg);
+	exit(1);
+}
+
+static void *grow(void *p, unsigned int n, unsigned int size)
+{
+	p = realloc(p, (n + 32) * size);
+	if (p == NULL)
+		fatal("out of memory", "");
+	return p;
+}
+
+static void add_entry(const char *text)
+{
+	if ((nent & 31) == 0)
+		ent = grow(ent, nent, sizeof(char *));
+	if ((ent[nent++] = strdup(text)) == NULL)
+		fatal("out of memory", "");
+}
+
+/* Length of the first field of s that ends at any of the stop characters */
+static unsigned int fieldlen(const char *s, const char *stop)
+{
+	return strcspn(s, stop);
+}
+
+static int find_entry(const char *name, unsigned int len)
+{
+	unsigned int i;
+	const char *p;
+
+	for (i = 0; i < nent; i++) {
+		p = ent[i];
+		do {
+			if (fieldlen(p, "|:") == len && memcmp(p, name, len) == 0)
+				return i;
+			p += fieldlen(p, "|:");
+		} while (*p++ == '|');
+	}
+	return -1;
+}
+
+static void load(const char *file)
+{
+	static char line[MAXENT];
+	static char buf[MAXENT];
+	FILE *fp;
+	unsigned int blen = 0;
+	unsigned int len;
+	int cont = 0;
+	char *p;
+
+	if ((fp = fopen(file, "r")) == NULL) {
+		perror(file);
+		exit(1);
+	}
+	while (fgets(line, MAXENT, fp)) {
+		p = line;
+		if (cont) {
+			while (isspace(*p))
+				p++;
+		} else if (*p == '#' || isspace(*p) || *p == 0)
+			continue;
+		len = strlen(p);
+		while (len && (p[len - 1] == '\n' || p[len - 1] == '\r'))
+			p[--len] = 0;
+		cont = len && p[len - 1] == '\\';
+		if (cont)
+			p[--len] = 0;
+		if (blen + len >= MAXENT)
+			fatal("entry too long: ", buf);
+		memcpy(buf + blen, p, len + 1);
+		blen += len;
+		if (!cont) {
+			add_entry(buf);
+			blen = 0;
+		}
+	}
+	if (blen)
+		add_entry(buf);
+	fclose(fp);
+}
+
+/* Replace each tc=name with the capabilities of that entry. The
+   capabilities already present come first so they take precedence */
+static void expand(unsigned int n)
+{
+	static char buf[MAXENT];
+	char *e = ent[n];
+	char *tc, *rest, *caps;
+	unsigned int len;
+	unsigned int depth = 0;
+	int t;
+
+	while ((tc = strstr(e, ":tc=")) != NULL) {
+		if (++depth > MAXTC)
+			fatal("tc= loop in ", e);
+		len = fieldlen(tc + 4, ":");
+		if ((t = find_entry(tc + 4, len)) == -1) {
+			tc[4 + len] = 0;
+			fatal("unknown terminal ", tc + 4);
+		}
+		rest = tc + 4 + len;
+		if (*rest == ':')
+			rest++;
+		caps = ent[t] + fieldlen(ent[t], ":");
+		if (*caps == ':')
+			caps++;
+		if ((tc - e) + 2 + strlen(rest) + strlen(caps) >= MAXENT)
+			fatal("entry too long after tc=: ", e);
+		memcpy(buf, e, tc - e + 1);
+		strcpy(buf + (tc - e) + 1, rest);
+		if (*rest && rest[strlen(rest) - 1] != ':')
+			strcat(buf, ":");
+		strcat(buf, caps);
+		free(e);
+		if ((e = strdup(buf)) == NULL)
+			fatal("out of memory", "");
+		ent[n] = e;
+	}
+}
+
+static void index_names(void)
+{
+	struct name *np;
+	unsigned int i;
+	const char *p, *c;
+	unsigned int len;
+
+	for (i = 0; i < nent; i++) {
+		p = ent[i];
+		do {
+			len = fieldlen(p, "|:");
+			/* The first entry with a name wins, as in the text file */
+			if (len && len < 256 && find_entry(p, len) == (int)i) {
+				if ((nnames & 31) == 0)
+					names = grow(names, nnames, sizeof(struct name));
+				np = names + nnames++;
+				np->name = (char *)p;
+				np->len = len;
+				np->entry = i;
+				np->hash = 0;
+				for (c = p; c < p + len; c++)
+					np->hash = (np->hash * 33 + (unsigned char)*c) & 0xFFFF;
+			}
+			p += len;
+		} while (*p++ == '|');
+	}
+}
+
+static void put16(unsigned long v, FILE *fp)
+{
+	putc(v & 0xFF, fp);
+	putc((v >> 8) & 0xFF, fp);
+}
+
+int main(int argc, char *argv[])
+{
+	const char *in = "/etc/termcap";
+	const char *out = "/etc/termcap.db";
+	unsigned int nbucket, b, i, j, first, next;
+	unsigned long off;
+	FILE *fp;
+
+	if (argc > 3) {
+		fprintf(stderr, "usage: %s [termcap [database]]\n", progname);
+		exit(1);
+	}
+	if (argc > 1)
+		in = argv[1];
+	if (argc > 2)
+		out = argv[2];
+
+	load(in);
+	for (i = 0; i < nent; i++)
+		expand(i);
+	index_names();
+
+	nbucket = (nnames / 2) | 1;
+
+	/* Work out where everything goes: the name records grouped by
+	   bucket and then the entries */
+	off = 6 + 2 * nbucket;
+	for (b = 0; b < nbucket; b++)
+		for (i = 0; i < nnames; i++)
+			if (names[i].hash % nbucket == b) {
+				names[i].offset = off;
+				off += 5 + names[i].len;
+			}
+	if ((entoff = malloc((nent + 1) * sizeof(unsigned int))) == NULL)
+		fatal("out of memory", "");
+	for (i = 0; i < nent; i++) {
+		entoff[i] = off;
+		off += 2 + strlen(ent[i]) + 1;
+	}
+	if (off > 0xFFFFUL)
+		fatal("database would be too large", "");
+
+	if ((fp = fopen(out, "w")) == NULL) {
+		perror(out);
+		exit(1);
+	}
+	fputs(TCDB_MAGIC, fp);
+	put16(nbucket, fp);
+	for (b = 0; b < nbucket; b++) {
+		first = 0;
+		for (i = 0; i < nnames; i++)
+			if (names[i].hash % nbucket == b) {
+				first = names[i].offset;
+				break;
+			}
+		put16(first, fp);
+	}
+	for (b = 0; b < nbucket; b++) {
+		for (i = 0; i < nnames; i++) {
+			if (names[i].hash % nbucket != b)
+				continue;
+			next = 0;
+			for (j = i + 1; j < nnames; j++)
+				if (names[j].hash % nbucket == b) {
+					next = names[j].offset;
+					break;
+				}
+			put16(next, fp);
+			put16(entoff[names[i].entry], fp);
+			putc(names[i].len, fp);
+			fwrite(names[i].name, names[i].len, 1, fp);
+		}
+	}
+	for (i = 0; i < nent; i++) {
+		put16(strlen(ent[i]) + 1, fp);
+		fwrite(ent[i], strlen(ent[i]) + 1, 1, fp);
+	}
+	if (fclose(fp)) {
+		perror(out);
+		exit(1);
+	}
+	return 0;
+}
@@ -18,11 +18,16 @@ static	char *sccsid = "@(#)sort.c	4.11 (Berkeley) 6/3/86";
 #include <sys/stat.h>
 
 #define	L	1024
-#define	N	7
+#ifndef OPEN_MAX
+#define	OPEN_MAX 16	/* Files a process can have open, if sysconf fails */
+#endif
+#define	MAXN	32	/* Most files we will merge at once */
+#define	MBUF	128	/* stdio buffer for each file being merged */
 #define	C	20
 
-/* FIXME: make this dynamic */
-#define	MEM	(4*2048)
+#define	MEM	(4*2048)	/* Least space we will work in */
+#define	MAXMEM	0xF000		/* Most we will take */
+#define	STACK	1024		/* Left between the break and the stack */
 
 #define NF	10
 
@@ -37,10 +42,9 @@ char	file1[30];
 char	*file = file1;
 char	*filep;
 int	nfiles;
-unsigned	nlines;
-unsigned	ntext;
+int	nway;
 int	*lspace;
-char	*tspace;
+char	**lend;
 int	cmp(char *, char *);
 int	(*compare)(char *, char *) = cmpa;
 int 	mflg;
@@ -263,7 +267,7 @@ void safeoutfil(void)
 		return;
 	if(stat(outfil,&obuf)==-1)
 		return;
-	for(i=eargc-N;i<eargc;i++) {	/*-N is suff., not nec.*/
+	for(i=eargc>nway?eargc-nway:0;i<eargc;i++) {	/*-nway is suff., not nec.*/
 		if(stat(eargv[i],&ibuf)==-1)
 			continue;
 		if(obuf.st_dev==ibuf.st_dev&&
@@ -290,9 +294,17 @@ void do_qsort(char **a, char **l)
 	int c;
 	char *t;
 	unsigned n;
+	/* We always stack the larger part so this is as deep as it gets */
+	char **stack[2 * 8 * sizeof(unsigned)];
+	char ***sp = stack;
 start:
-	if((n=l-a) <= 1)
-		return;
+	if((n=l-a) <= 1) {
+		if(sp == stack)
+			return;
+		l = *--sp;
+		a = *--sp;
+		goto start;
+	}
 
 
 	n /= 2;
@@ -342,11 +354,13 @@ loop:
 			if(uflg)
 				for(k=lp+1; k<=hp;) **k++ = '\0';
 			if(lp-a >= l-hp) {
-				do_qsort(hp+1, l);
-				l = lp;
-			} else {
-				do_qsort(a, lp);
+				*sp++ = a;
+				*sp++ = lp;
 				a = hp+1;
+			} else {
+				*sp++ = hp+1;
+				*sp++ = l;
+				l = lp;
 			}
 			goto start;
 		}
@@ -361,8 +375,8 @@ loop:
 void sort(void)
 {
 	char *cp;
-	char **lp;
-	int lines, text, len;
+	char **lp, **ep;
+	int len;
 	int done = 0;
 	int i = 0;
 	char *f;
@@ -373,12 +387,12 @@ void sort(void)
 	else if((is = fopen(f, "r")) == NULL)
 		cant(f);
 
+	/* The text grows up from the bottom of the space and the line
+	   pointers down from the top until they meet */
 	do {
-		cp = tspace;
-		lp = (char **)lspace;
-		lines = nlines;
-		text = ntext;
-		while(lines > 0 && text > 0) {
+		cp = (char *)lspace;
+		lp = lend;
+		while((char *)lp - cp >= L + sizeof(char *)) {
 			if(fgets(cp, L, is) == NULL) {
 				if(i >= eargc) {
 					++done;
@@ -391,14 +405,14 @@ void sort(void)
 					cant(f);
 				continue;
 			}
-			*lp++ = cp;
+			*--lp = cp;
 			len = strlen(cp) + 1; /* null terminate */
 			if(cp[len - 2] != '\n')
 				if (len == L) {
 					diag("line too long (skipped): ", cp);
 					while((c=getc(is)) != EOF && c != '\n')
 						/* throw it away */;
-					--lp;
+					++lp;
 					continue;
 				} else {
 					diag("missing newline before EOF in ",
@@ -409,17 +423,16 @@ void sort(void)
 					cp[len - 1] = '\0';
 				}
 			cp += len;
-			--lines;
-			text -= len;
 		}
-		do_qsort((char **)lspace, lp);
+		do_qsort(lp, lend);
 		if(done == 0 || nfiles != eargc)
 			newfile();
 		else
 			oldfile();
 		clearerr(os);
-		while(lp > (char **)lspace) {
-			cp = *--lp;
+		ep = lend;
+		while(ep > lp) {
+			cp = *--ep;
 			if(*cp)
 				fputs(cp, os);
 			if (ferror(os)) {
@@ -429,101 +442,98 @@ void sort(void)
 		}
 		fclose(os);
 	} while(done == 0);
+	/* Don't hold the last input open through the merge */
+	if(is != stdin)
+		fclose(is);
 }
 
 struct merg
 {
 	char	l[L];
 	FILE	*b;
-} *ibuf[256];
+} *ibuf[MAXN];
+
+/* The inputs are kept as a heap with the line to go next on top so that
+   each line costs log2(ways) compares to place rather than ways */
+void siftdown(int i, int n)
+{
+	struct merg *t = ibuf[i];
+	int c;
+
+	while((c = 2*i + 1) < n) {
+		if(c + 1 < n && (*compare)(ibuf[c+1]->l, ibuf[c]->l) > 0)
+			c++;
+		if((*compare)(ibuf[c]->l, t->l) <= 0)
+			break;
+		ibuf[i] = ibuf[c];
+		i = c;
+	}
+	ibuf[i] = t;
+}
 
 void merge(int a, int b)
 {
 	struct	merg	*p;
 	char	*cp, *dp;
 	int i;
-	struct merg **ip, *jp;
 	char	*f;
 	int	j;
-	int	k, l;
+	int	n;
 	int	muflg;
+	int	last = 0;
+	unsigned bufmax = __stdio_bufmax;
 
+	/* There are a lot of inputs and each is only read a line at a time,
+	   so give them small buffers and leave the space for sorting */
+	__stdio_bufmax = MBUF;
 	p = (struct merg *)lspace;
-	j = 0;
+	n = 0;
 	for(i=a; i < b; i++) {
 		f = setfil(i);
 		if(f == 0)
 			p->b = stdin;
 		else if((p->b = fopen(f, "r")) == NULL)
 			cant(f);
-		ibuf[j] = p;
-		if(!rline(p))	j++;
+		if(!rline(p))
+			ibuf[n++] = p;
 		p++;
 	}
-
-	do {
-		i = j;
-		do_qsort((char **)ibuf, (char **)(ibuf+i));
-		l = 0;
-		while(i--) {
-			cp = ibuf[i]->l;
-			if(*cp == '\0') {
-				l = 1;
-				if(rline(ibuf[i])) {
-					k = i;
-					while(++k < j)
-						ibuf[k-1] = ibuf[k];
-					j--;
-				}
-			}
-		}
-	} while(l);
+	__stdio_bufmax = bufmax;
+	for(i = n/2; i-- > 0; )
+		siftdown(i, n);
 
 	clearerr(os);
-	muflg = mflg & uflg | cflg;
-	i = j;
-	while(i > 0) {
-		cp = ibuf[i-1]->l;
-		if (!cflg && (uflg == 0 || muflg || i == 1 ||
-			(*compare)(ibuf[i-1]->l,ibuf[i-2]->l))) {
+	/* For -u and -c we keep the last line in p to check against */
+	muflg = uflg | cflg;
+	while(n > 0) {
+		cp = ibuf[0]->l;
+		if(muflg && last) {
+			j = (*compare)(cp, p->l);
+			if(cflg) {
+				if(j > 0)
+					disorder("disorder:", cp);
+				else if(uflg && j == 0)
+					disorder("nonunique:", cp);
+			} else if(j == 0)
+				goto next;
+		}
+		if(!cflg) {
 			fputs(cp, os);
 			if (ferror(os)) {
 				error = 1;
 				term(0);
 			}
 		}
-		if(muflg){
-			cp = ibuf[i-1]->l;
+		if(muflg) {
 			dp = p->l;
 			do {
 			} while((*dp++ = *cp++) != '\n');
+			last = 1;
 		}
-		for(;;) {
-			if(rline(ibuf[i-1])) {
-				i--;
-				if(i == 0)
-					break;
-				if(i == 1)
-					muflg = uflg;
-			}
-			ip = &ibuf[i];
-			while(--ip>ibuf&&(*compare)(ip[0]->l,ip[-1]->l)<0){
-				jp = *ip;
-				*ip = *(ip-1);
-				*(ip-1) = jp;
-			}
-			if(!muflg)
-				break;
-			j = (*compare)(ibuf[i-1]->l,p->l);
-			if(cflg) {
-				if(j > 0)
-					disorder("disorder:",ibuf[i-1]->l);
-				else if(uflg && j==0)
-					disorder("nonunique:",ibuf[i-1]->l);
-			} else if(j == 0)
-				continue;
-			break;
-		}
+next:
+		if(rline(ibuf[0]))
+			ibuf[0] = ibuf[--n];
+		siftdown(0, n);
 	}
 	p = (struct merg *)lspace;
 	for(i=a; i<b; i++) {
@@ -686,25 +696,54 @@ int main(int argc, char *argv[])
 		diag("can check only 1 file","");
 		exit(1);
 	}
-	safeoutfil();
-
-	ep = (uint8_t *)sbrk(0) + MEM;
 
-#if 0	
-	/* FIXME: do this nicely using &sp */
-	lspace = (int *)sbrk(0);
-	while((int)brk(ep) == -1)
-		ep -= 512;
-#ifndef	vax
-	brk(ep -= 512);	/* for recursion */
-#endif
-#endif
+	/* Merge as many files at once as we can have open. Standard output
+	   and error and the output file are always open, as is standard
+	   input if we didn't sort */
+	nway = sysconf(_SC_OPEN_MAX);
+	if (nway <= 0)
+		nway = OPEN_MAX;
+	nway -= (mflg | cflg) ? 4 : 3;
+	if (nway > MAXN)
+		nway = MAXN;
+	if (nway < 2)
+		nway = 2;
+	safeoutfil();
 
-	a = ep - (char*)lspace;
-	nlines = (a-L);
-	nlines /= (5*(sizeof(char *)/sizeof(char)));
-	ntext = nlines * 4 * (sizeof(char *)/sizeof(char));
-	tspace = (char *)(lspace + nlines);
+	/* Take the space between the break and the stack, less the stack
+	   and the stdio buffers. The input and output get at most
+	   __stdio_bufmax bytes from fopen(), the files we merge MBUF, and
+	   each has the FILE and malloc overhead on top */
+	{
+		uintptr_t top = (uintptr_t)&a;
+		uintptr_t bot;
+		unsigned keep = STACK + nway * (MBUF + 32) +
+				2 * (__stdio_bufmax + 32);
+		unsigned size = MEM;
+
+		ep = sbrk(0);
+		bot = (uintptr_t)ep;
+		if (top > bot && top - bot > MEM + keep) {
+			if (top - bot - keep > MAXMEM)
+				size = MAXMEM;
+			else
+				size = top - bot - keep;
+		}
+		/* size can be more than sbrk() takes as it is signed, so
+		   set the break directly as malloc does */
+		while (brk(ep + size)) {
+			if (size <= MEM) {
+				diag("not enough memory", "");
+				exit(1);
+			}
+			size -= 512;
+		}
+		lspace = (int *)(((uintptr_t)ep + sizeof(char *) - 1) & ~(sizeof(char *) - 1));
+		lend = (char **)(((uintptr_t)ep + size) & ~(sizeof(char *) - 1));
+	}
+	a = ((char *)lend - (char *)lspace) / sizeof(struct merg) - 1;
+	if (nway > a)
+		nway = a;
 	a = -1;
 
 	/* FIXME: redo tmp files */
@@ -734,8 +773,8 @@ int main(int argc, char *argv[])
 		sort();
 		fclose(stdin);
 	}
-	for(a = mflg|cflg?0:eargc; a+N<nfiles || unsafeout&&a<eargc; a=i) {
-		i = a+N;
+	for(a = mflg|cflg?0:eargc; a+nway<nfiles || unsafeout&&a<eargc; a=i) {
+		i = a+nway;
 		if(i>=nfiles)
 			i = nfiles;
 		newfile();
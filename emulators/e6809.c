@@ -2,6 +2,7 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <errno.h>
 #include "e6809.h"
 #include "d6809.h"
@@ -80,6 +81,19 @@ static unsigned trace_cpu;
 /* If 1, we hit a write breakpoint */
 static unsigned write_brkpt= 0;
 
+/* total cycles executed since reset */
+
+static unsigned long cycle_count;
+
+/* block cache generation, bumped whenever the cache is flushed,
+ * and a bitmap of the bytes which hold translated instructions.
+ */
+
+static unsigned bc_gen = 1;
+static uint8_t bc_codemap[65536 / 8];
+
+static void bc_flush (void);
+
 /* user defined read and write functions */
 
 unsigned char e6809_read8(unsigned address);
@@ -197,7 +211,9 @@ static einline void write8 (unsigned address, unsigned data)
 {
 	address &= 0xffff;
 	e6809_write8(address, (unsigned char) data);
-	if (is_breakpoint(address, BRK_WRITE)) {
+	if (bc_codemap[address >> 3] & (1 << (address & 7)))
+		bc_flush ();
+	if (have_breakpoints() && is_breakpoint(address, BRK_WRITE)) {
 	  write_brkpt= 1;
 	  printf("Write at $%04X\n", address);
 	}
@@ -1135,6 +1151,9 @@ void e6809_reset (uint16_t sp, uint16_t pc)
 	irq_status = IRQ_NORMAL;
 
 	reg_pc = pc;
+
+	cycle_count = 0;
+	bc_flush ();
 }
 
 uint16_t e6809_get_pc(void) {
@@ -1173,92 +1192,14 @@ void e6809_get_statestr(char *buffer) {
 	reg_y & 0xffff, reg_u & 0xffff, reg_s & 0xffff);
 }
 
-/* Execute a single instruction or handle interrupts and return */
-unsigned e6809_sstep (unsigned irq_i, unsigned irq_f)
+/* Execute the instruction at the PC and return the cycles it took */
+static unsigned execute_op (void)
 {
 	unsigned op;
 	unsigned cycles = 0;
 	unsigned ea, i0, i1, r;
 	int longresult;
 	int32_t result;
-  	char buf[80];
-  	char *sym=NULL;
-  	int addr, offset;
-
-	// If the PC is a breakpoint, or we hit a write
-	// breakpoint, fall into the monitor
-	if (write_brkpt==1 || is_breakpoint(reg_pc, BRK_INST)) {
-	  write_brkpt=0;
-	  addr= monitor(reg_pc);
-
-	  // If we have a new PC from the monitor, set it
-	  if (addr != -1)
-	    reg_pc= addr & 0xffff;
-	}
-
-	if (irq_f) {
-		if (get_cc (FLAG_F) == 0) {
-			if (irq_status != IRQ_CWAI) {
-				set_cc (FLAG_E, 0);
-				inst_psh (0x81, &reg_s, reg_u, &cycles);
-			}
-
-			set_cc (FLAG_I, 1);
-			set_cc (FLAG_F, 1);
-
-			reg_pc = read16 (0xfff6);
-			irq_status = IRQ_NORMAL;
-			cycles += 7;
-			if (trace_cpu)
-				fprintf(stderr, "\nF Interrupt\n");
-		} else {
-			if (irq_status == IRQ_SYNC) {
-				irq_status = IRQ_NORMAL;
-			}
-		}
-	}
-
-	if (irq_i) {
-		if (get_cc (FLAG_I) == 0) {
-			if (irq_status != IRQ_CWAI) {
-				set_cc (FLAG_E, 1);
-				inst_psh (0xff, &reg_s, reg_u, &cycles);
-			}
-
-			set_cc (FLAG_I, 1);
-
-			reg_pc = read16 (0xfff8);
-			irq_status = IRQ_NORMAL;
-			cycles += 7;
-			if (trace_cpu)
-				fprintf(stderr, "\nI Interrupt\n");
-		} else {
-			if (irq_status == IRQ_SYNC) {
-				irq_status = IRQ_NORMAL;
-			}
-		}
-	}
-
-	if (irq_status != IRQ_NORMAL) {
-		return cycles + 1;
-	}
-
-	// Disassemble the current instruction.
-	// Once the instruction executes, we will
-	// print out the CPU state
-	if (logfile!=NULL) {
-	  d6809_disassemble(buf, reg_pc & 0xffff);
-
-	  // See if we have a symbol at this address
-	  sym=NULL;
-  	  if (mapfile_loaded)
-    	    sym= get_symbol_and_offset(reg_pc, &offset);
-
-  	  if (sym!=NULL)
-    	    fprintf(logfile, "%12s+%04X: %-16.16s | ", sym, offset, buf);
-  	  else
-    	    fprintf(logfile, "%04X: %-16.16s | ", reg_pc & 0xffff, buf);
-	}
 
 	op = pc_read8();
 
@@ -2712,6 +2653,99 @@ unsigned e6809_sstep (unsigned irq_i, unsigned irq_f)
 		exit(1);
 	}
 
+	return cycles;
+}
+
+/* Execute a single instruction or handle interrupts and return */
+unsigned e6809_sstep (unsigned irq_i, unsigned irq_f)
+{
+	unsigned cycles = 0;
+  	char buf[80];
+  	char *sym=NULL;
+  	int addr, offset;
+
+	// If the PC is a breakpoint, or we hit a write
+	// breakpoint, fall into the monitor
+	if (write_brkpt==1 || is_breakpoint(reg_pc, BRK_INST)) {
+	  write_brkpt=0;
+	  addr= monitor(reg_pc);
+
+	  // If we have a new PC from the monitor, set it
+	  if (addr != -1)
+	    reg_pc= addr & 0xffff;
+
+	  // The monitor may have rewritten code
+	  bc_flush ();
+	}
+
+	if (irq_f) {
+		if (get_cc (FLAG_F) == 0) {
+			if (irq_status != IRQ_CWAI) {
+				set_cc (FLAG_E, 0);
+				inst_psh (0x81, &reg_s, reg_u, &cycles);
+			}
+
+			set_cc (FLAG_I, 1);
+			set_cc (FLAG_F, 1);
+
+			reg_pc = read16 (0xfff6);
+			irq_status = IRQ_NORMAL;
+			cycles += 7;
+			if (trace_cpu)
+				fprintf(stderr, "\nF Interrupt\n");
+		} else {
+			if (irq_status == IRQ_SYNC) {
+				irq_status = IRQ_NORMAL;
+			}
+		}
+	}
+
+	if (irq_i) {
+		if (get_cc (FLAG_I) == 0) {
+			if (irq_status != IRQ_CWAI) {
+				set_cc (FLAG_E, 1);
+				inst_psh (0xff, &reg_s, reg_u, &cycles);
+			}
+
+			set_cc (FLAG_I, 1);
+
+			reg_pc = read16 (0xfff8);
+			irq_status = IRQ_NORMAL;
+			cycles += 7;
+			if (trace_cpu)
+				fprintf(stderr, "\nI Interrupt\n");
+		} else {
+			if (irq_status == IRQ_SYNC) {
+				irq_status = IRQ_NORMAL;
+			}
+		}
+	}
+
+	if (irq_status != IRQ_NORMAL) {
+		cycle_count += cycles + 1;
+		return cycles + 1;
+	}
+
+	// Disassemble the current instruction.
+	// Once the instruction executes, we will
+	// print out the CPU state
+	if (logfile!=NULL) {
+	  d6809_disassemble(buf, reg_pc & 0xffff);
+
+	  // See if we have a symbol at this address
+	  sym=NULL;
+  	  if (mapfile_loaded)
+    	    sym= get_symbol_and_offset(reg_pc, &offset);
+
+  	  if (sym!=NULL)
+    	    fprintf(logfile, "%12s+%04X: %-16.16s | ", sym, offset, buf);
+  	  else
+    	    fprintf(logfile, "%04X: %-16.16s | ", reg_pc & 0xffff, buf);
+	}
+
+	cycles += execute_op ();
+	cycle_count += cycles;
+
 	if (logfile != NULL) {
 	  e6809_get_statestr(buf);
   	  fprintf(logfile, "%s\n", buf);
@@ -2720,6 +2754,624 @@ unsigned e6809_sstep (unsigned irq_i, unsigned irq_f)
 	return reg_pc;
 }
 
+/* basic-block translation cache
+ *
+ * A block is a run of straight-line instructions ending at the first
+ * one which can change the flow of control. The common instructions
+ * which fcc emits are decoded once into a handler plus their operand
+ * and addressing mode; anything else is run by execute_op() as an
+ * ordinary instruction. Some frequent sequences are fused into a
+ * single handler: LDD/ADDD/STD and LDD/SUBD/STD on one location, and
+ * CMPX followed by a short branch.
+ *
+ * Every byte of a translated instruction is marked in bc_codemap[],
+ * and a store to a marked byte flushes the whole cache.
+ */
+
+#define BC_MAXOPS	32	/* most instructions in a block */
+#define BC_ENTRIES	2048	/* blocks, direct-mapped by start address */
+
+enum {
+	BC_IMMEDIATE,
+	BC_DIRECT,
+	BC_INDEXED,
+	BC_EXTENDED
+};
+
+/* a pre-decoded operand */
+
+struct bc_ea {
+	unsigned mode;		/* one of the BC_ modes above */
+	unsigned *reg;		/* index register for BC_INDEXED */
+	unsigned val;		/* immediate value, address or index offset */
+};
+
+/* a translated instruction */
+
+struct bc_op {
+	void (*func) (const struct bc_op *op, unsigned *cycles);
+	uint16_t pc;		/* address of the instruction */
+	uint16_t next;		/* address of the instruction after it */
+	unsigned cycles;	/* fixed cycle count, incl. the post-byte */
+	unsigned *reg;		/* register loaded, stored or pushed on */
+	unsigned arg;		/* opcode or PSH/PUL post-byte */
+	unsigned offset;	/* sign-extended branch offset */
+	struct bc_ea ea;	/* the operand */
+	struct bc_ea ea2;	/* the ADDD/SUBD operand when fused */
+};
+
+struct bc_block {
+	unsigned gen;		/* bc_gen when the block was translated */
+	uint16_t start;		/* address of the first instruction */
+	int count;		/* number of translated instructions */
+	unsigned runs;		/* times run, for the native code generator */
+	unsigned (*native) (void);	/* compiled code, or NULL */
+	int nnative;		/* instructions the compiled code covers */
+	struct bc_op ops[BC_MAXOPS];
+};
+
+static struct bc_block bc_blocks[BC_ENTRIES];
+
+/* throw away every translated block */
+
+static void bc_flush (void)
+{
+	bc_gen++;
+	memset (bc_codemap, 0, sizeof (bc_codemap));
+}
+
+/* len bytes at address were written behind the CPU's back, e.g.
+ * by a system call. Flush the cache if any of them were code.
+ */
+void e6809_invalidate (unsigned address, unsigned len)
+{
+	for (; len != 0; len--, address++)
+		if (bc_codemap[(address & 0xffff) >> 3] & (1 << (address & 7))) {
+			bc_flush ();
+			return;
+		}
+}
+
+/* the effective address of a non-immediate operand */
+
+static einline unsigned bc_addr (const struct bc_ea *ea)
+{
+	switch (ea->mode) {
+	case BC_DIRECT:
+		return (reg_dp << 8) | ea->val;
+	case BC_INDEXED:
+		return *ea->reg + ea->val;
+	default:
+		return ea->val;
+	}
+}
+
+static einline unsigned bc_read8 (const struct bc_ea *ea)
+{
+	if (ea->mode == BC_IMMEDIATE)
+		return ea->val;
+	return read8 (bc_addr (ea));
+}
+
+static einline unsigned bc_read16 (const struct bc_ea *ea)
+{
+	if (ea->mode == BC_IMMEDIATE)
+		return ea->val;
+	return read16 (bc_addr (ea));
+}
+
+/* the condition tested by the short branch opcode op,
+ * in the form wanted by inst_bra8().
+ */
+
+static einline unsigned bc_branch_test (unsigned op)
+{
+	switch (op & 0xe) {
+	case 0x0:
+		return 0;
+	case 0x2:
+		return get_cc (FLAG_C) | get_cc (FLAG_Z);
+	case 0x4:
+		return get_cc (FLAG_C);
+	case 0x6:
+		return get_cc (FLAG_Z);
+	case 0x8:
+		return get_cc (FLAG_V);
+	case 0xa:
+		return get_cc (FLAG_N);
+	case 0xc:
+		return get_cc (FLAG_N) ^ get_cc (FLAG_V);
+	default:
+		return get_cc (FLAG_Z) | (get_cc (FLAG_N) ^ get_cc (FLAG_V));
+	}
+}
+
+static einline void bc_branch (const struct bc_op *op)
+{
+	unsigned mask;
+
+	mask = (bc_branch_test (op->arg) ^ (op->arg & 1)) - 1;
+	reg_pc += op->offset & mask;
+}
+
+/* handlers for translated instructions. Each one leaves the PC
+ * pointing at the next instruction to run.
+ */
+
+static void bc_interp (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->pc;
+	*cycles += execute_op ();
+}
+
+static void bc_ldd (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	set_reg_d (bc_read16 (&op->ea));
+	inst_tst16 (get_reg_d ());
+	*cycles += op->cycles;
+}
+
+static void bc_std (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	write16 (bc_addr (&op->ea), get_reg_d ());
+	inst_tst16 (get_reg_d ());
+	*cycles += op->cycles;
+}
+
+static void bc_ld16 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	*op->reg = bc_read16 (&op->ea);
+	inst_tst16 (*op->reg);
+	*cycles += op->cycles;
+}
+
+static void bc_st16 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	write16 (bc_addr (&op->ea), *op->reg);
+	inst_tst16 (*op->reg);
+	*cycles += op->cycles;
+}
+
+static void bc_ld8 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	*op->reg = bc_read8 (&op->ea);
+	inst_tst8 (*op->reg);
+	*cycles += op->cycles;
+}
+
+static void bc_st8 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	write8 (bc_addr (&op->ea), *op->reg);
+	inst_tst8 (*op->reg);
+	*cycles += op->cycles;
+}
+
+static void bc_addd (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	set_reg_d (inst_add16 (get_reg_d (), bc_read16 (&op->ea)));
+	*cycles += op->cycles;
+}
+
+static void bc_subd (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	set_reg_d (inst_sub16 (get_reg_d (), bc_read16 (&op->ea)));
+	*cycles += op->cycles;
+}
+
+static void bc_cmpx (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	inst_sub16 (reg_x, bc_read16 (&op->ea));
+	*cycles += op->cycles;
+}
+
+static void bc_lea (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	*op->reg = bc_addr (&op->ea);
+	/* leax and leay set Z, leas and leau don't */
+	if (op->reg == &reg_x || op->reg == &reg_y)
+		set_cc (FLAG_Z, test_z16 (*op->reg));
+	*cycles += op->cycles;
+}
+
+static void bc_psh (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	if (op->reg == &reg_s)
+		inst_psh (op->arg, &reg_s, reg_u, cycles);
+	else
+		inst_psh (op->arg, &reg_u, reg_s, cycles);
+	*cycles += op->cycles;
+}
+
+static void bc_pul (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	if (op->reg == &reg_s)
+		inst_pul (op->arg, &reg_s, &reg_u, cycles);
+	else
+		inst_pul (op->arg, &reg_u, &reg_s, cycles);
+	*cycles += op->cycles;
+}
+
+static void bc_bra8 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	bc_branch (op);
+	*cycles += op->cycles;
+}
+
+/* fused: ldd ea ; addd/subd ea2 ; std ea */
+
+static void bc_ldd_op_std (const struct bc_op *op, unsigned *cycles)
+{
+	unsigned ea;
+
+	reg_pc = op->next;
+	ea = bc_addr (&op->ea);
+	set_reg_d (read16 (ea));
+	inst_tst16 (get_reg_d ());
+	if (op->arg == 0xc3)
+		set_reg_d (inst_add16 (get_reg_d (), bc_read16 (&op->ea2)));
+	else
+		set_reg_d (inst_sub16 (get_reg_d (), bc_read16 (&op->ea2)));
+	write16 (ea, get_reg_d ());
+	inst_tst16 (get_reg_d ());
+	*cycles += op->cycles;
+}
+
+/* fused: cmpx ea ; bcc */
+
+static void bc_cmpx_bra8 (const struct bc_op *op, unsigned *cycles)
+{
+	reg_pc = op->next;
+	inst_sub16 (reg_x, bc_read16 (&op->ea));
+	bc_branch (op);
+	*cycles += op->cycles;
+}
+
+/* the page 0 instructions with the four usual addressing modes
+ * which we translate, and their cycle counts in each mode. The
+ * opcode is matched with the mode bits masked off. A zero cycle
+ * count marks an invalid mode.
+ */
+
+static const struct bc_insn {
+	unsigned opcode;
+	void (*func) (const struct bc_op *op, unsigned *cycles);
+	unsigned *reg;
+	unsigned immsize;
+	unsigned cycles[4];
+} bc_insns[] = {
+	{ 0xcc, bc_ldd,  NULL,   2, { 3, 5, 5, 6 } },	/* ldd */
+	{ 0xcd, bc_std,  NULL,   2, { 0, 5, 5, 6 } },	/* std */
+	{ 0xc3, bc_addd, NULL,   2, { 4, 6, 6, 7 } },	/* addd */
+	{ 0x83, bc_subd, NULL,   2, { 4, 6, 6, 7 } },	/* subd */
+	{ 0x8c, bc_cmpx, NULL,   2, { 4, 6, 6, 7 } },	/* cmpx */
+	{ 0x8e, bc_ld16, &reg_x, 2, { 3, 5, 5, 6 } },	/* ldx */
+	{ 0x8f, bc_st16, &reg_x, 2, { 0, 5, 5, 6 } },	/* stx */
+	{ 0xce, bc_ld16, &reg_u, 2, { 3, 5, 5, 6 } },	/* ldu */
+	{ 0xcf, bc_st16, &reg_u, 2, { 0, 5, 5, 6 } },	/* stu */
+	{ 0x86, bc_ld8,  &reg_a, 1, { 2, 4, 4, 5 } },	/* lda */
+	{ 0xc6, bc_ld8,  &reg_b, 1, { 2, 4, 4, 5 } },	/* ldb */
+	{ 0x87, bc_st8,  &reg_a, 1, { 0, 4, 4, 5 } },	/* sta */
+	{ 0xc7, bc_st8,  &reg_b, 1, { 0, 4, 4, 5 } },	/* stb */
+	{ 0, NULL, NULL, 0, { 0, 0, 0, 0 } }
+};
+
+/* the registers loaded by leax, leay, leas and leau */
+
+static unsigned *bc_lea_regs[4] = {
+	&reg_x,
+	&reg_y,
+	&reg_s,
+	&reg_u
+};
+
+/* decode the indexed post-byte at pc. Only the constant offset
+ * forms are handled. Returns the number of operand bytes, or 0
+ * if the mode must be left to the interpreter.
+ */
+
+static unsigned bc_decode_indexed (unsigned pc, struct bc_ea *ea,
+								   unsigned *cycles)
+{
+	unsigned op;
+
+	op = read8 (pc);
+	ea->mode = BC_INDEXED;
+	ea->reg = rptr_xyus[(op >> 5) & 3];
+
+	if ((op & 0x80) == 0) {
+		/* R, +[-16, 15] */
+		if (op & 0x10)
+			ea->val = (op & 0xf) - 0x10;
+		else
+			ea->val = op & 0xf;
+		*cycles += 1;
+		return 1;
+	}
+
+	switch (op & 0x9f) {
+	case 0x84:
+		/* ,R */
+		ea->val = 0;
+		return 1;
+	case 0x88:
+		/* byte,R */
+		ea->val = sign_extend (read8 (pc + 1));
+		*cycles += 1;
+		return 2;
+	case 0x89:
+		/* word,R */
+		ea->val = read16 (pc + 1);
+		*cycles += 4;
+		return 3;
+	}
+	return 0;
+}
+
+/* decode an operand in one of the four usual addressing modes.
+ * Returns the number of operand bytes, or 0 if unsupported.
+ */
+
+static unsigned bc_decode_ea (unsigned pc, unsigned mode, unsigned immsize,
+							  struct bc_ea *ea, unsigned *cycles)
+{
+	ea->mode = mode;
+	ea->reg = NULL;
+
+	switch (mode) {
+	case BC_IMMEDIATE:
+		ea->val = (immsize == 2) ? read16 (pc) : read8 (pc);
+		return immsize;
+	case BC_DIRECT:
+		ea->val = read8 (pc);
+		return 1;
+	case BC_EXTENDED:
+		ea->val = read16 (pc);
+		return 2;
+	default:
+		return bc_decode_indexed (pc, ea, cycles);
+	}
+}
+
+/* does the instruction at pc, which we are not translating,
+ * change the flow of control?
+ */
+
+static int bc_is_jump (unsigned pc, unsigned op)
+{
+	unsigned post;
+
+	switch (op) {
+	case 0x0e: case 0x6e: case 0x7e:	/* jmp */
+	case 0x16: case 0x17: case 0x8d:	/* lbra, lbsr, bsr */
+	case 0x9d: case 0xad: case 0xbd:	/* jsr */
+	case 0x39: case 0x3b: case 0x3f:	/* rts, rti, swi */
+	case 0x3c: case 0x13:			/* cwai, sync */
+		return 1;
+	case 0x1e: case 0x1f:			/* exg, tfr */
+		post = read8 (pc + 1);
+		return ((post & 0xf) == 5 || (post >> 4) == 5);
+	case 0x37:				/* pulu */
+		return (read8 (pc + 1) & 0x80) != 0;
+	case 0x10:
+		op = read8 (pc + 1);
+		return ((op >= 0x21 && op <= 0x2f) || op == 0x3f);
+	case 0x11:
+		return (read8 (pc + 1) == 0x3f);
+	}
+	return (op >= 0x20 && op <= 0x2f);
+}
+
+/* translate the instruction at pc into op.
+ * Returns 1 if it ends the block.
+ */
+
+static int bc_translate_op (unsigned pc, struct bc_op *op)
+{
+	const struct bc_insn *insn;
+	unsigned opcode, len, mode;
+	char buf[80];
+
+	opcode = read8 (pc);
+	op->pc = pc;
+	op->arg = opcode;
+	op->cycles = 0;
+
+	/* loads, stores and arithmetic */
+	mode = (opcode >> 4) & 3;
+	for (insn = bc_insns; insn->func != NULL; insn++) {
+		if (insn->opcode != (opcode & 0xcf) || insn->cycles[mode] == 0)
+			continue;
+		op->cycles = insn->cycles[mode];
+		len = bc_decode_ea (pc + 1, mode, insn->immsize, &op->ea,
+							&op->cycles);
+		if (len == 0)
+			break;
+		op->func = insn->func;
+		op->reg = insn->reg;
+		op->next = pc + 1 + len;
+		return 0;
+	}
+
+	switch (opcode) {
+	/* leax, leay, leas, leau */
+	case 0x30: case 0x31: case 0x32: case 0x33:
+		op->cycles = 4;
+		len = bc_decode_indexed (pc + 1, &op->ea, &op->cycles);
+		if (len == 0)
+			break;
+		op->func = bc_lea;
+		op->reg = bc_lea_regs[opcode & 3];
+		op->next = pc + 1 + len;
+		return 0;
+	/* pshs, puls, pshu, pulu */
+	case 0x34: case 0x35: case 0x36: case 0x37:
+		op->func = (opcode & 1) ? bc_pul : bc_psh;
+		op->reg = (opcode & 2) ? &reg_u : &reg_s;
+		op->arg = read8 (pc + 1);
+		op->cycles = 5;
+		op->next = pc + 2;
+		/* a pull of the PC is a return */
+		return (opcode & 1) && (op->arg & 0x80);
+	}
+
+	/* short branches */
+	if (opcode >= 0x20 && opcode <= 0x2f) {
+		op->func = bc_bra8;
+		op->offset = sign_extend (read8 (pc + 1));
+		op->cycles = 3;
+		op->next = pc + 2;
+		return 1;
+	}
+
+	/* anything else is left to the interpreter */
+	op->func = bc_interp;
+	op->next = pc + d6809_disassemble (buf, pc);
+	return bc_is_jump (pc, opcode);
+}
+
+static int bc_same_ea (const struct bc_ea *a, const struct bc_ea *b)
+{
+	return (a->mode == b->mode && a->reg == b->reg && a->val == b->val);
+}
+
+/* try to fuse the last instruction in the block with the ones
+ * before it. Returns the new number of instructions.
+ */
+
+static int bc_fuse (struct bc_op *ops, int count)
+{
+	struct bc_op *last = &ops[count - 1];
+
+	/* cmpx ; bcc */
+	if (count >= 2 && last->func == bc_bra8 &&
+		ops[count - 2].func == bc_cmpx) {
+		ops[count - 2].func = bc_cmpx_bra8;
+		ops[count - 2].arg = last->arg;
+		ops[count - 2].offset = last->offset;
+		ops[count - 2].cycles += last->cycles;
+		ops[count - 2].next = last->next;
+		return count - 1;
+	}
+
+	/* ldd ea ; addd/subd ea2 ; std ea */
+	if (count >= 3 && last->func == bc_std &&
+		ops[count - 3].func == bc_ldd &&
+		(ops[count - 2].func == bc_addd ||
+		 ops[count - 2].func == bc_subd) &&
+		bc_same_ea (&ops[count - 3].ea, &last->ea)) {
+		ops[count - 3].func = bc_ldd_op_std;
+		ops[count - 3].arg = ops[count - 2].arg & 0xcf;
+		ops[count - 3].ea2 = ops[count - 2].ea;
+		ops[count - 3].cycles += ops[count - 2].cycles + last->cycles;
+		ops[count - 3].next = last->next;
+		return count - 2;
+	}
+
+	return count;
+}
+
+/* translate the block starting at pc */
+
+static void bc_translate (struct bc_block *blk, unsigned pc)
+{
+	struct bc_op *op;
+	unsigned addr;
+	int last;
+
+	blk->gen = bc_gen;
+	blk->start = pc;
+	blk->count = 0;
+	blk->runs = 0;
+	blk->native = NULL;
+	blk->nnative = 0;
+
+	do {
+		op = &blk->ops[blk->count];
+		last = bc_translate_op (pc, op);
+
+		for (addr = pc; addr != op->next; addr = (addr + 1) & 0xffff)
+			bc_codemap[addr >> 3] |= 1 << (addr & 7);
+
+		pc = op->next;
+		blk->count = bc_fuse (blk->ops, blk->count + 1);
+	} while (!last && blk->count < BC_MAXOPS);
+}
+
+#ifdef __x86_64__
+#include "j6809.c"
+#else
+static void jit_block (struct bc_block *blk)
+{
+}
+
+static void jit_block_done (void)
+{
+}
+
+int e6809_enable_jit (int checked)
+{
+	return -1;
+}
+#endif
+
+/* Execute a basic block from the block cache and return the PC.
+ * This falls back to e6809_sstep() when tracing, when breakpoints
+ * are set or when the CPU is waiting for an interrupt.
+ */
+unsigned e6809_bstep (void)
+{
+	struct bc_block *blk;
+	unsigned cycles = 0;
+	unsigned gen;
+	int i;
+
+	if (logfile != NULL || write_brkpt || have_breakpoints() ||
+		irq_status != IRQ_NORMAL)
+		return e6809_sstep (0, 0);
+
+	blk = &bc_blocks[reg_pc % BC_ENTRIES];
+	if (blk->gen != bc_gen || blk->start != reg_pc)
+		bc_translate (blk, reg_pc);
+	jit_block (blk);
+
+	/* stop early if the block overwrites translated code */
+	gen = bc_gen;
+	i = 0;
+	if (blk->native != NULL && blk->gen == gen) {
+		cycles = blk->native ();
+		i = blk->nnative;
+	}
+	for (; i < blk->count && bc_gen == gen; i++)
+		blk->ops[i].func (&blk->ops[i], &cycles);
+	jit_block_done ();
+
+	cycle_count += cycles;
+	return reg_pc;
+}
+
+unsigned long e6809_get_cycles(void)
+{
+	return cycle_count;
+}
+
+void e6809_set_cycles(unsigned long cycles)
+{
+	cycle_count = cycles;
+}
+
 struct reg6809 *e6809_get_regs(void)
 {
 	static struct reg6809 r;
@@ -2734,3 +3386,16 @@ struct reg6809 *e6809_get_regs(void)
 	r.cc = reg_cc;
 	return &r;
 }
+
+void e6809_set_regs(const struct reg6809 *r)
+{
+	reg_x = r->x;
+	reg_y = r->y;
+	reg_u = r->u;
+	reg_s = r->s;
+	reg_pc = r->pc;
+	reg_a = r->a;
+	reg_b = r->b;
+	reg_dp = r->dp;
+	reg_cc = r->cc;
+}
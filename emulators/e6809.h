@@ -9,12 +9,24 @@ extern FILE *logfile;
 extern unsigned char e6809_read8(unsigned address);
 extern void e6809_write8(unsigned address, unsigned char data);
 
+/* user defined write handler for each 256-byte page, or NULL if the
+ * page is plain RAM. Native code stores straight to ram[] unless the
+ * page has a handler.
+ */
+typedef void (*e6809_page_write_t)(unsigned address, unsigned char data);
+extern e6809_page_write_t e6809_page_write[256];
+
 void e6809_reset (uint16_t sp, uint16_t pc);
 uint16_t e6809_get_pc(void);
 void e6809_set_pc(uint16_t pc);
 const char *e6809_get_flagstr(void);
 void e6809_get_statestr(char *buffer);
 unsigned e6809_sstep (unsigned irq_i, unsigned irq_f);
+unsigned e6809_bstep (void);
+unsigned long e6809_get_cycles(void);
+void e6809_set_cycles(unsigned long cycles);
+int e6809_enable_jit (int checked);
+void e6809_invalidate (unsigned address, unsigned len);
 
 struct reg6809 {
     uint16_t pc;
@@ -23,5 +35,6 @@ struct reg6809 {
 };
 
 struct reg6809 *e6809_get_regs(void);
+void e6809_set_regs(const struct reg6809 *r);
 
 #endif
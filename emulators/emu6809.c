@@ -37,26 +37,46 @@ static char *default_envp[] = {
   NULL
 };
 
-unsigned char e6809_read8(unsigned addr) {
-  return ram[addr & 0xffff];
-}
+// In lockstep mode the reference CPU runs on its own copy of memory.
+// mem points at the memory of the CPU which is running.
+static uint8_t shadow[65536];
+static uint8_t *mem = ram;
+static int lockstep = 0;
+
+// The stores made by one CPU in one lockstep round
+#define LS_MAXWRITES	1024
+struct ls_writes {
+  int cnt;
+  uint16_t addr[LS_MAXWRITES];
+  uint8_t val[LS_MAXWRITES];
+};
+static struct ls_writes ls_fastwrites, ls_refwrites;
+static struct ls_writes *ls_cur = &ls_fastwrites;
 
-unsigned char e6809_read8_debug(unsigned addr) {
-  if (addr < 0xFE00 || addr >= 0xFF00)
-    return ram[addr & 0xffff];
-  else
-    return 0xFF;
+unsigned char e6809_read8(unsigned addr) {
+  return mem[addr & 0xffff];
 }
 
 static unsigned char fefcval = 0;
 
-void e6809_write8(unsigned addr, unsigned char val) {
+/* Writes to certain addresses act like system calls */
+/* 0xFEFF:  exit() with the val as the exit value */
+/* 0xFEFE:  putchar(val) */
+/* 0xFEFC/D: print out the 16-bit value as a decimal */
+#define IO_PORTS	0xFEFC
+
+static void io_write(unsigned addr, unsigned char val) {
   int x;
 
-  /* Writes to certain addresses act like system calls */
-  /* 0xFEFF:  exit() with the val as the exit value */
-  /* 0xFEFE:  putchar(val) */
-  /* 0xFEFC/D: print out the 16-bit value as a decimal */
+  // The rest of the page is plain memory
+  if (addr < IO_PORTS) {
+    mem[addr] = val;
+    return;
+  }
+
+  // Only the fast CPU gets to do any I/O
+  if (mem == shadow)
+    return;
 
   switch (addr) {
   case 0xFEFF:
@@ -77,11 +97,45 @@ void e6809_write8(unsigned addr, unsigned char val) {
   case 0xFEFC:
     fefcval = val;		/* Save high byte for now */
     break;
-  default:
-    ram[addr & 0xffff] = val;
   }
 }
 
+// The write handler for each 256-byte page of memory.
+// Pages with no handler are plain RAM. In lockstep mode
+// handlers are also called for the reference CPU: they
+// should then store to mem[] and leave out any I/O.
+e6809_page_write_t e6809_page_write[256] = {
+  [0xFE] = io_write
+};
+
+unsigned char e6809_read8_debug(unsigned addr) {
+  addr &= 0xffff;
+  if (e6809_page_write[addr >> 8] == NULL)
+    return ram[addr];
+  else
+    return 0xFF;
+}
+
+void e6809_write8(unsigned addr, unsigned char val) {
+  e6809_page_write_t handler;
+
+  addr &= 0xffff;
+
+  if (lockstep) {
+    if (ls_cur->cnt < LS_MAXWRITES) {
+      ls_cur->addr[ls_cur->cnt] = addr;
+      ls_cur->val[ls_cur->cnt] = val;
+    }
+    ls_cur->cnt++;
+  }
+
+  handler = e6809_page_write[addr >> 8];
+  if (handler == NULL)
+    mem[addr] = val;
+  else
+    handler(addr, val);
+}
+
 /* FUZIX executable header */
 static struct exec E;
 
@@ -146,11 +200,169 @@ void dumpram() {
 }
 #endif
 
+// Lockstep mode. The fast CPU (e6809_bstep(), and any native
+// code) runs a block on ram[]. Then the reference CPU runs
+// e6809_sstep() on shadow[] from where it last stopped until it has
+// used the same number of cycles. The registers, cycle counts and
+// the stores each one made are compared, and we stop at the first
+// difference. System calls are only run by the fast CPU: the
+// reference CPU stops at the SWI and is then copied from the fast one.
+
+#define LS_MAXTRACE	64
+
+static struct reg6809 ls_fast, ls_ref;
+static unsigned long ls_fastcycles, ls_refcycles;
+static uint16_t ls_trace[LS_MAXTRACE];
+static int ls_tracecnt;
+
+// Print an address, with a symbol if we have one
+static void ls_print_addr(unsigned addr) {
+  char *sym = NULL;
+  int offset;
+
+  if (mapfile_loaded)
+    sym = get_symbol_and_offset(addr, &offset);
+  if (sym != NULL)
+    fprintf(stderr, "$%04X (%s+$%X)", addr, sym, offset);
+  else
+    fprintf(stderr, "$%04X", addr);
+}
+
+static void ls_print_writes(char *name, struct ls_writes *w) {
+  int i;
+
+  fprintf(stderr, "%s stores:", name);
+  for (i = 0; i < w->cnt && i < LS_MAXWRITES; i++) {
+    fprintf(stderr, "%s$%04X=$%02X", (i % 6) ? " " : "\n\t",
+	    w->addr[i], w->val[i]);
+  }
+  if (w->cnt > LS_MAXWRITES)
+    fprintf(stderr, " ... (%d in all)", w->cnt);
+  fprintf(stderr, "\n");
+}
+
+// Report a difference and stop
+static void ls_report(unsigned start, char *what) {
+  char buf[80];
+  int i;
+
+  fprintf(stderr, "Lockstep: %s after the block at ", what);
+  ls_print_addr(start);
+  fprintf(stderr, "\n\n          fast       reference\n");
+  fprintf(stderr, "pc        $%04X      $%04X\n", ls_fast.pc, ls_ref.pc);
+  fprintf(stderr, "a         $%02X        $%02X\n", ls_fast.a, ls_ref.a);
+  fprintf(stderr, "b         $%02X        $%02X\n", ls_fast.b, ls_ref.b);
+  fprintf(stderr, "x         $%04X      $%04X\n", ls_fast.x, ls_ref.x);
+  fprintf(stderr, "y         $%04X      $%04X\n", ls_fast.y, ls_ref.y);
+  fprintf(stderr, "u         $%04X      $%04X\n", ls_fast.u, ls_ref.u);
+  fprintf(stderr, "s         $%04X      $%04X\n", ls_fast.s, ls_ref.s);
+  fprintf(stderr, "dp        $%02X        $%02X\n", ls_fast.dp, ls_ref.dp);
+  fprintf(stderr, "cc        $%02X        $%02X\n", ls_fast.cc, ls_ref.cc);
+  fprintf(stderr, "cycles    %-10lu %lu\n\n", ls_fastcycles, ls_refcycles);
+
+  fprintf(stderr, "Instructions run by the reference CPU:\n");
+  for (i = 0; i < ls_tracecnt; i++) {
+    d6809_disassemble(buf, ls_trace[i]);
+    fprintf(stderr, "\t");
+    ls_print_addr(ls_trace[i]);
+    fprintf(stderr, "\t%s\n", buf);
+  }
+  fprintf(stderr, "\n");
+  ls_print_writes("Fast", &ls_fastwrites);
+  ls_print_writes("Reference", &ls_refwrites);
+  exit(1);
+}
+
+// Make the reference CPU a copy of the fast one
+static void ls_sync(void) {
+  ls_ref = ls_fast;
+  ls_refcycles = ls_fastcycles;
+  memcpy(shadow, ram, sizeof(shadow));
+}
+
+static int ls_same_writes(void) {
+  if (ls_fastwrites.cnt != ls_refwrites.cnt)
+    return (0);
+  return (memcmp(ls_fastwrites.addr, ls_refwrites.addr,
+		 ls_fastwrites.cnt * sizeof(uint16_t)) == 0 &&
+	  memcmp(ls_fastwrites.val, ls_refwrites.val, ls_fastwrites.cnt) == 0);
+}
+
+// Run one block on each CPU and compare them
+static void ls_step(void) {
+  unsigned start = ls_fast.pc;
+  int swi = 0;
+
+  // The fast CPU
+  mem = ram;
+  ls_cur = &ls_fastwrites;
+  ls_fastwrites.cnt = 0;
+  e6809_set_regs(&ls_fast);
+  e6809_set_cycles(ls_fastcycles);
+  e6809_bstep();
+  ls_fast = *e6809_get_regs();
+  ls_fastcycles = e6809_get_cycles();
+
+  // The reference CPU
+  mem = shadow;
+  ls_cur = &ls_refwrites;
+  ls_refwrites.cnt = 0;
+  ls_tracecnt = 0;
+  e6809_set_regs(&ls_ref);
+  e6809_set_cycles(ls_refcycles);
+  while (ls_refcycles < ls_fastcycles) {
+    if (shadow[ls_ref.pc] == 0x3f) {
+      swi = 1;
+      break;
+    }
+    if (ls_tracecnt < LS_MAXTRACE)
+      ls_trace[ls_tracecnt++] = ls_ref.pc;
+    e6809_sstep(0, 0);
+    ls_ref = *e6809_get_regs();
+    ls_refcycles = e6809_get_cycles();
+  }
+  mem = ram;
+
+  // We can't compare stores we didn't keep
+  if (ls_fastwrites.cnt > LS_MAXWRITES || ls_refwrites.cnt > LS_MAXWRITES)
+    ls_report(start, "too many stores to check");
+  if (!ls_same_writes())
+    ls_report(start, "the stores differ");
+
+  // The system call changed the fast CPU's registers
+  // and memory, so just check that both got to the SWI.
+  if (swi) {
+    if (ls_fast.pc != ((ls_ref.pc + 1) & 0xffff) ||
+	ls_fast.u != ls_ref.u || ls_fast.s != ls_ref.s ||
+	ls_fast.dp != ls_ref.dp)
+      ls_report(start, "the registers differ at a system call");
+    ls_sync();
+    return;
+  }
+
+  if (ls_fastcycles != ls_refcycles)
+    ls_report(start, "the cycle counts differ");
+  if (memcmp(&ls_fast, &ls_ref, sizeof(ls_fast)) != 0)
+    ls_report(start, "the registers differ");
+}
+
+// Never returns: the program exits through a system call
+// or a write to 0xFEFF.
+static void run_lockstep(void) {
+  ls_fast = *e6809_get_regs();
+  ls_fastcycles = e6809_get_cycles();
+  ls_sync();
+  while (1)
+    ls_step();
+}
+
 void usage(char *name) {
-  fprintf(stderr, "Usage: %s [-M] [-d logfile] [-m mapfile] [-b addr] executable <arguments>\n\n", name);
+  fprintf(stderr, "Usage: %s [-M] [-j] [-l] [-d logfile] [-m mapfile] [-b addr] executable <arguments>\n\n", name);
   fprintf(stderr, "\t-d: write debugging information to logfile\n");
   fprintf(stderr, "\t-m: load a mapfile with symbol information\n");
   fprintf(stderr, "\t-M: start in the monitor\n");
+  fprintf(stderr, "\t-j: compile frequently run code to native code\n");
+  fprintf(stderr, "\t-l: check the fast CPU against the reference CPU in lockstep\n");
   fprintf(stderr, "\t-b: set breakpoint at address (decimal or $hex)\n\n");
   fprintf(stderr, "\tIf the FUZIXROOT environment variable is set,\n");
   fprintf(stderr, "\tuse that as the executable's root directory.\n");
@@ -168,6 +380,7 @@ int main(int argc, char *argv[]) {
   int breakpoint;
   char **brkstr;		// Array of breakpoint strings
   int i, brkcnt=0;
+  int jit=0;
 
   if (argc<2) usage(argv[0]);
   Emuname= argv[0];
@@ -180,7 +393,7 @@ int main(int argc, char *argv[]) {
   // up any command-line breakpoints
   monitor_init();
 
-  while ((opt = getopt(argc, argv, "+d:m:Mb:")) != -1) {
+  while ((opt = getopt(argc, argv, "+d:m:Mjlb:")) != -1) {
     switch (opt) {
     case 'd':
       logfile= fopen(optarg, "w+");
@@ -195,6 +408,12 @@ int main(int argc, char *argv[]) {
     case 'M':
       start_in_monitor=1;
       break;
+    case 'j':
+      jit=1;
+      break;
+    case 'l':
+      lockstep=1;
+      break;
     case 'b':
       // Cache the pointer for now
       brkstr[brkcnt++]= optarg;
@@ -204,6 +423,11 @@ int main(int argc, char *argv[]) {
     }
   }
 
+  // Stores from native code must be visible in lockstep mode
+  if (jit && e6809_enable_jit(lockstep) == -1) {
+    fprintf(stderr, "Native code generation is not available\n"); exit(1);
+  }
+
   // Clear the memory
   memset(ram, 0, 0x10000);
 
@@ -260,8 +484,10 @@ int main(int argc, char *argv[]) {
       e6809_reset(sp,(uint16_t)pc);
   }
 
-  // Otherwise loop executing instructions
+  // Otherwise loop executing blocks of instructions
+  if (lockstep)
+    run_lockstep();
   while (1)
-    e6809_sstep(0, 0);
+    e6809_bstep();
   return 0;
 }
@@ -35,6 +35,7 @@
 // The monitor itself provides these functions:
 // - void set_breakpoint(int addr, int type)
 // - int is_breakpoint(int addr, int type)
+// - int have_breakpoints(void)
 // - int parse_addr(char *addr, int *issym)
 // - void monitor_init(void)
 // - int monitor(int addr)
@@ -190,12 +191,18 @@ typedef struct {
 #define NUM_BRKPOINTS 30
 static brkpoint brkpointlist[NUM_BRKPOINTS];
 
+// Number of slots in use in brkpointlist[]
+static int brkpointcnt = 0;
+
 // Remove a breakpoint at the given address
 static void remove_breakpoint(int addr) {
   int i;
   for (i = 0; i < NUM_BRKPOINTS; i++) {
-    if (brkpointlist[i].addr == addr)
+    if (brkpointlist[i].addr == addr &&
+	brkpointlist[i].brktype != BRK_EMPTY) {
       brkpointlist[i].brktype = BRK_EMPTY;
+      brkpointcnt--;
+    }
   }
 }
 
@@ -204,6 +211,7 @@ static void remove_all_breakpoints(void) {
   int i;
   for (i = 0; i < NUM_BRKPOINTS; i++)
     brkpointlist[i].brktype = BRK_EMPTY;
+  brkpointcnt = 0;
 }
 
 // Set a breakpoint
@@ -214,6 +222,7 @@ void set_breakpoint(int addr, int type) {
     if (brkpointlist[i].brktype == BRK_EMPTY) {
       brkpointlist[i].brktype = type;
       brkpointlist[i].addr = addr;
+      brkpointcnt++;
       return;
     }
   printf("No free breakpoint slot to set a breakpoint!\n");
@@ -245,6 +254,13 @@ int is_breakpoint(int addr, int type) {
   return (0);
 }
 
+// Return 1 if any breakpoints are set, 0 otherwise.
+// Emulators can use this to skip the per-instruction
+// is_breakpoint() checks when running fast paths.
+int have_breakpoints(void) {
+  return (brkpointcnt != 0);
+}
+
 // Dump or disassemble memory
 static void dump_mem(int start, int end, int cmd) {
   int addr = start;
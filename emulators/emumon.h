@@ -12,6 +12,7 @@ enum brkpt_nums
 /* emumon.c */
 void set_breakpoint(int addr, int type);
 int is_breakpoint(int addr, int type);
+int have_breakpoints(void);
 int parse_addr(char *addr, int *issym);
 void monitor_init(void);
 int monitor(int addr);
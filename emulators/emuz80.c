@@ -34,14 +34,50 @@ static char *default_envp[] = {
   NULL
 };
 
-uint8_t mem_read(int unused, uint16_t addr)
+// In lockstep mode the reference CPU runs on its own copy of memory.
+// The memParam of each CPU says whose memory it is, and whether to
+// keep its stores for checking. Everything outside the CPUs (system
+// calls, the monitor) uses MEM_RAM.
+#define MEM_RAM		0	// ram[]
+#define MEM_FAST	1	// ram[], stores kept
+#define MEM_REF		2	// shadow[], stores kept
+static uint8_t shadow[65536];
+static int lockstep = 0;
+
+// The stores made by one CPU in one lockstep round
+#define LS_MAXWRITES	1024
+struct ls_writes {
+  int cnt;
+  uint16_t addr[LS_MAXWRITES];
+  uint8_t val[LS_MAXWRITES];
+};
+static struct ls_writes ls_fastwrites, ls_refwrites;
+
+uint8_t mem_read(int which, uint16_t addr)
 {
+    if (which == MEM_REF)
+        return shadow[addr];
     return ram[addr];
 }
 
-void mem_write(int unused, uint16_t addr, uint8_t val)
+void mem_write(int which, uint16_t addr, uint8_t val)
 {
-    ram[addr] = val;
+    struct ls_writes *w;
+
+    if (which == MEM_RAM) {
+        ram[addr] = val;
+        return;
+    }
+    w = (which == MEM_REF) ? &ls_refwrites : &ls_fastwrites;
+    if (w->cnt < LS_MAXWRITES) {
+        w->addr[w->cnt] = addr;
+        w->val[w->cnt] = val;
+    }
+    w->cnt++;
+    if (which == MEM_REF)
+        shadow[addr] = val;
+    else
+        ram[addr] = val;
 }
 
 uint8_t io_read(int unused, uint16_t port)
@@ -91,6 +127,11 @@ void io_write(int unused, uint16_t port, uint8_t value)
     }
 }
 
+// Only the fast CPU gets to do any I/O
+static void ls_io_write(int unused, uint16_t port, uint8_t value)
+{
+}
+
 static unsigned int nbytes;
 
 uint8_t z80dis_byte(uint16_t addr)
@@ -206,11 +247,181 @@ static uint16_t load_executable(char *filename) {
   exit(1);
 }
 
+// Lockstep mode. The fast CPU runs one block from the block cache
+// on ram[]. Then the reference CPU, a second context without the
+// cache, runs Z80Execute() on shadow[] from where it last stopped
+// until it has used the same number of tstates. The registers,
+// tstates and the stores each one made are compared, and we stop at
+// the first difference. System calls are only run by the fast CPU:
+// the reference CPU stops at the RST and is then copied from the
+// fast one.
+
+#define LS_MAXTRACE	64
+
+static Z80Context ls_ref;
+static unsigned long ls_fastcycles, ls_refcycles;
+static uint16_t ls_trace[LS_MAXTRACE];
+static int ls_tracecnt;
+
+// Print an address, with a symbol if we have one
+static void ls_print_addr(unsigned addr) {
+  char *sym = NULL;
+  int offset;
+
+  if (mapfile_loaded)
+    sym = get_symbol_and_offset(addr, &offset);
+  if (sym != NULL)
+    fprintf(stderr, "$%04X (%s+$%X)", addr, sym, offset);
+  else
+    fprintf(stderr, "$%04X", addr);
+}
+
+static void ls_print_writes(char *name, struct ls_writes *w) {
+  int i;
+
+  fprintf(stderr, "%s stores:", name);
+  for (i = 0; i < w->cnt && i < LS_MAXWRITES; i++) {
+    fprintf(stderr, "%s$%04X=$%02X", (i % 6) ? " " : "\n\t",
+	    w->addr[i], w->val[i]);
+  }
+  if (w->cnt > LS_MAXWRITES)
+    fprintf(stderr, " ... (%d in all)", w->cnt);
+  fprintf(stderr, "\n");
+}
+
+// Report a difference and stop
+static void ls_report(unsigned start, char *what) {
+  Z80Context *f = &cpu_z80, *r = &ls_ref;
+  char buf[80];
+  int i;
+
+  fprintf(stderr, "Lockstep: %s after the block at ", what);
+  ls_print_addr(start);
+  fprintf(stderr, "\n\n          fast       reference\n");
+  fprintf(stderr, "pc        $%04X      $%04X\n", f->PC, r->PC);
+  fprintf(stderr, "af        $%04X      $%04X\n", f->R1.wr.AF, r->R1.wr.AF);
+  fprintf(stderr, "bc        $%04X      $%04X\n", f->R1.wr.BC, r->R1.wr.BC);
+  fprintf(stderr, "de        $%04X      $%04X\n", f->R1.wr.DE, r->R1.wr.DE);
+  fprintf(stderr, "hl        $%04X      $%04X\n", f->R1.wr.HL, r->R1.wr.HL);
+  fprintf(stderr, "ix        $%04X      $%04X\n", f->R1.wr.IX, r->R1.wr.IX);
+  fprintf(stderr, "iy        $%04X      $%04X\n", f->R1.wr.IY, r->R1.wr.IY);
+  fprintf(stderr, "sp        $%04X      $%04X\n", f->R1.wr.SP, r->R1.wr.SP);
+  fprintf(stderr, "af'       $%04X      $%04X\n", f->R2.wr.AF, r->R2.wr.AF);
+  fprintf(stderr, "bc'       $%04X      $%04X\n", f->R2.wr.BC, r->R2.wr.BC);
+  fprintf(stderr, "de'       $%04X      $%04X\n", f->R2.wr.DE, r->R2.wr.DE);
+  fprintf(stderr, "hl'       $%04X      $%04X\n", f->R2.wr.HL, r->R2.wr.HL);
+  fprintf(stderr, "i r       $%02X $%02X    $%02X $%02X\n", f->I, f->R, r->I, r->R);
+  fprintf(stderr, "iff im    %u %u %u      %u %u %u\n", f->IFF1, f->IFF2, f->IM,
+	  r->IFF1, r->IFF2, r->IM);
+  fprintf(stderr, "tstates   %-10lu %lu\n\n", ls_fastcycles, ls_refcycles);
+
+  fprintf(stderr, "Instructions run by the reference CPU:\n");
+  for (i = 0; i < ls_tracecnt; i++) {
+    z80_disasm(buf, ls_trace[i]);
+    fprintf(stderr, "\t");
+    ls_print_addr(ls_trace[i]);
+    fprintf(stderr, "\t%s\n", buf);
+  }
+  fprintf(stderr, "\n");
+  ls_print_writes("Fast", &ls_fastwrites);
+  ls_print_writes("Reference", &ls_refwrites);
+  exit(1);
+}
+
+// Make the reference CPU a copy of the fast one
+static void ls_sync(void) {
+  ls_ref = cpu_z80;
+  ls_ref.memParam = MEM_REF;
+  ls_ref.ioWrite = ls_io_write;
+  ls_ref.trace = NULL;
+  ls_ref.bcache = NULL;
+  ls_refcycles = ls_fastcycles;
+  memcpy(shadow, ram, sizeof(shadow));
+}
+
+static int ls_same_writes(void) {
+  if (ls_fastwrites.cnt != ls_refwrites.cnt)
+    return (0);
+  return (memcmp(ls_fastwrites.addr, ls_refwrites.addr,
+		 ls_fastwrites.cnt * sizeof(uint16_t)) == 0 &&
+	  memcmp(ls_fastwrites.val, ls_refwrites.val, ls_fastwrites.cnt) == 0);
+}
+
+static int ls_same_regs(void) {
+  Z80Context *f = &cpu_z80, *r = &ls_ref;
+
+  return (memcmp(&f->R1, &r->R1, sizeof(f->R1)) == 0 &&
+	  memcmp(&f->R2, &r->R2, sizeof(f->R2)) == 0 &&
+	  f->PC == r->PC && f->R == r->R && f->I == r->I &&
+	  f->IFF1 == r->IFF1 && f->IFF2 == r->IFF2 && f->IM == r->IM &&
+	  f->halted == r->halted);
+}
+
+// Run one block on each CPU and compare them
+static void ls_step(void) {
+  unsigned start = cpu_z80.PC;
+  int rst = 0;
+
+  // The fast CPU. Asking for one tstate runs a single block.
+  ls_fastwrites.cnt = 0;
+  ls_fastcycles += Z80ExecuteTStates(&cpu_z80, 1);
+
+  // The reference CPU. Every RST is a system call.
+  ls_refwrites.cnt = 0;
+  ls_tracecnt = 0;
+  while (ls_refcycles < ls_fastcycles) {
+    if ((shadow[ls_ref.PC] & 0xC7) == 0xC7) {
+      rst = 1;
+      break;
+    }
+    if (ls_tracecnt < LS_MAXTRACE)
+      ls_trace[ls_tracecnt++] = ls_ref.PC;
+    ls_ref.tstates = 0;
+    Z80Execute(&ls_ref);
+    ls_refcycles += ls_ref.tstates;
+  }
+
+  // We can't compare stores we didn't keep
+  if (ls_fastwrites.cnt > LS_MAXWRITES || ls_refwrites.cnt > LS_MAXWRITES)
+    ls_report(start, "too many stores to check");
+  if (!ls_same_writes())
+    ls_report(start, "the stores differ");
+
+  // The system call changed the fast CPU's registers
+  // and memory, so just check that both got to the RST.
+  if (rst) {
+    if (cpu_z80.PC != ((ls_ref.PC + 1) & 0xffff) ||
+	cpu_z80.R1.wr.SP != ls_ref.R1.wr.SP ||
+	cpu_z80.R1.wr.IX != ls_ref.R1.wr.IX ||
+	cpu_z80.R1.wr.IY != ls_ref.R1.wr.IY)
+      ls_report(start, "the registers differ at a system call");
+    ls_sync();
+    return;
+  }
+
+  if (ls_fastcycles != ls_refcycles)
+    ls_report(start, "the tstates differ");
+  if (!ls_same_regs())
+    ls_report(start, "the registers differ");
+}
+
+// Never returns: the program exits through a system call
+// or a write to port 0xFF.
+static void run_lockstep(void) {
+  cpu_z80.memParam = MEM_FAST;
+  ls_fastcycles = 0;
+  ls_sync();
+  while (1)
+    ls_step();
+}
+
 void usage(char *name) {
-  fprintf(stderr, "Usage: %s [-M] [-d logfile] [-m mapfile] [-b addr] executable <arguments>\n\n", name);
+  fprintf(stderr, "Usage: %s [-M] [-n] [-l] [-d logfile] [-m mapfile] [-b addr] executable <arguments>\n\n", name);
   fprintf(stderr, "\t-d: write debugging information to logfile\n");
   fprintf(stderr, "\t-m: load a mapfile with symbol information\n");
   fprintf(stderr, "\t-M: start in the monitor\n");
+  fprintf(stderr, "\t-n: interpret each instruction, without the block cache\n");
+  fprintf(stderr, "\t-l: check the block cache against the interpreter in lockstep\n");
   fprintf(stderr, "\t-b: set breakpoint at address (decimal or $hex)\n\n");
   fprintf(stderr, "\tIf the FUZIXROOT environment variable is set,\n");
   fprintf(stderr, "\tuse that as the executable's root directory.\n");
@@ -226,6 +437,7 @@ int main(int argc, char *argv[])
   char **brkstr;                // Array of breakpoint strings
   int i, brkcnt=0;
   int breakpoint;
+  int nocache=0;
 
   if (argc<2) usage(argv[0]);
   Emuname=argv[0];
@@ -238,7 +450,7 @@ int main(int argc, char *argv[])
   // up any command-line breakpoints
   // monitor_init();
 
-  while ((opt = getopt(argc, argv, "+d:m:Mb:")) != -1) {
+  while ((opt = getopt(argc, argv, "+d:m:Mnlb:")) != -1) {
     switch (opt) {
     case 'd':
       logfile= fopen(optarg, "w+");
@@ -253,6 +465,12 @@ int main(int argc, char *argv[])
     case 'M':
       start_in_monitor=1;
       break;
+    case 'n':
+      nocache=1;
+      break;
+    case 'l':
+      lockstep=1;
+      break;
     case 'b':
       // Cache the pointer for now
       brkstr[brkcnt++]= optarg;
@@ -261,6 +479,9 @@ int main(int argc, char *argv[])
       usage(argv[0]);
     }
   }
+  // Lockstep checks the block cache, so it needs it
+  if (nocache && lockstep)
+    usage(argv[0]);
 
   // Clear the memory
   memset(ram, 0, 0x10000);
@@ -317,6 +538,13 @@ int main(int argc, char *argv[])
   cpu_z80.memWrite = mem_write;
   cpu_z80.trace = z80_trace;
 
+  // Run straight-line code from the block cache. This
+  // is flushed by Z80RESET() above when we are exec'd.
+  // -n leaves it off, to compare against the interpreter.
+  if (!nocache && Z80EnableBlockCache(&cpu_z80) == -1) {
+    fprintf(stderr, "Unable to allocate the block cache\n"); exit(1);
+  }
+
   // Start in the monitor if needed
   if (start_in_monitor) {
     pc= monitor(pc);
@@ -325,6 +553,8 @@ int main(int argc, char *argv[])
       cpu_z80.PC= pc;
   }
 
+  if (lockstep)
+    run_lockstep();
   while(1)
     Z80ExecuteTStates(&cpu_z80, 1000);
 }
@@ -0,0 +1,815 @@
+/* x86-64 native code generator for the 6809 block cache.
+ *
+ * This is #included by e6809.c, so it sees the CPU registers and
+ * the translated blocks. When a block has run JIT_THRESHOLD times
+ * the longest prefix of its instructions which we know how to
+ * compile is turned into x86-64 code in an executable buffer. The
+ * rest of the block, and any block containing syscalls, MMIO or
+ * other awkward instructions, stays with the handlers in e6809.c.
+ *
+ * While native code runs the 6809 registers live in host registers:
+ *
+ *	D  rbx (A in bits 15-8, B in bits 7-0)
+ *	X  r12		Y  r13		U  r14		S  r15
+ *	CC rbp
+ *
+ * rax, rcx, rdx, rsi, rdi and r8-r11 are scratch. Reads go straight
+ * to ram[]. Stores to a page with a handler in e6809_page_write[] or
+ * to a byte in bc_codemap[] go through write8() instead, and if that
+ * flushed the block cache the native code returns after the current
+ * instruction.
+ *
+ * Each native block returns the cycles it used and leaves reg_pc
+ * pointing at the next instruction to run.
+ */
+
+#include <sys/mman.h>
+
+#ifndef JIT_THRESHOLD
+#define JIT_THRESHOLD	64		/* runs before a block is compiled */
+#endif
+#define JIT_SIZE	(1024 * 1024)	/* size of the code buffer */
+#define JIT_MAXBLOCK	(16 * 1024)	/* most code one block can need */
+
+extern uint8_t ram[];
+
+static uint8_t *jit_buf;		/* the executable code buffer */
+static uint8_t *jit_p;			/* where the next byte goes */
+static uint8_t *jit_epilogue;		/* the shared exit code */
+static unsigned jit_gen;		/* bc_gen the buffer was filled in */
+static int jit_enabled;
+static int jit_checked;			/* send every store to write8() */
+static int jit_full;			/* flush once the block has run */
+
+/* host registers */
+
+enum {
+	RAX, RCX, RDX, RBX, RSP, RBP, RSI, RDI,
+	R8, R9, R10, R11, R12, R13, R14, R15
+};
+
+/* x86 ALU operations, as the /digit of opcode 0x81 */
+
+enum {
+	ALU_ADD = 0, ALU_OR = 1, ALU_AND = 4, ALU_SUB = 5, ALU_CMP = 7
+};
+
+/* x86 condition codes */
+
+enum {
+	CC_O = 0x0, CC_C = 0x2, CC_Z = 0x4, CC_NZ = 0x5, CC_S = 0x8
+};
+
+static void emit8 (unsigned b)
+{
+	*jit_p++ = b;
+}
+
+static void emit32 (uint32_t v)
+{
+	memcpy (jit_p, &v, 4);
+	jit_p += 4;
+}
+
+static void emit64 (uint64_t v)
+{
+	memcpy (jit_p, &v, 8);
+	jit_p += 8;
+}
+
+/* a REX prefix if one is needed for these register fields */
+
+static void emit_rex (int w, int reg, int index, int base)
+{
+	unsigned rex = 0x40 | (w << 3) | ((reg >> 3) << 2) |
+				   ((index >> 3) << 1) | (base >> 3);
+
+	if (rex != 0x40)
+		emit8 (rex);
+}
+
+static void emit_modrm (int mod, int reg, int rm)
+{
+	emit8 ((mod << 6) | ((reg & 7) << 3) | (rm & 7));
+}
+
+/* op r/m32, r32 (or the 16-bit form) between two registers */
+
+static void emit_rr (int wide16, unsigned op, int dst, int src)
+{
+	if (wide16)
+		emit8 (0x66);
+	emit_rex (0, src, 0, dst);
+	emit8 (op);
+	emit_modrm (3, src, dst);
+}
+
+/* mov r32, imm32 */
+
+static void emit_mov_imm (int reg, uint32_t imm)
+{
+	emit_rex (0, 0, 0, reg);
+	emit8 (0xb8 + (reg & 7));
+	emit32 (imm);
+}
+
+/* mov r64, imm64 */
+
+static void emit_movabs_imm (int reg, uint64_t imm)
+{
+	emit_rex (1, 0, 0, reg);
+	emit8 (0xb8 + (reg & 7));
+	emit64 (imm);
+}
+
+static void emit_movabs (int reg, const void *ptr)
+{
+	emit_movabs_imm (reg, (uintptr_t) ptr);
+}
+
+/* alu r32, imm32 */
+
+static void emit_alu_imm (int alu, int reg, uint32_t imm)
+{
+	emit_rex (0, 0, 0, reg);
+	emit8 (0x81);
+	emit_modrm (3, alu, reg);
+	emit32 (imm);
+}
+
+/* shl/shr r32, imm8 */
+
+static void emit_shl (int reg, unsigned n)
+{
+	emit_rex (0, 0, 0, reg);
+	emit8 (0xc1);
+	emit_modrm (3, 4, reg);
+	emit8 (n);
+}
+
+static void emit_shr (int reg, unsigned n)
+{
+	emit_rex (0, 0, 0, reg);
+	emit8 (0xc1);
+	emit_modrm (3, 5, reg);
+	emit8 (n);
+}
+
+/* mov r32, [rax] and mov [rax], r32 */
+
+static void emit_load_rax (int reg)
+{
+	emit_rex (0, reg, 0, RAX);
+	emit8 (0x8b);
+	emit_modrm (0, reg, RAX);
+}
+
+static void emit_store_rax (int reg)
+{
+	emit_rex (0, reg, 0, RAX);
+	emit8 (0x89);
+	emit_modrm (0, reg, RAX);
+}
+
+/* movzx r32, byte [base + index] */
+
+static void emit_load_byte (int reg, int base, int index)
+{
+	emit_rex (0, reg, index, base);
+	emit8 (0x0f);
+	emit8 (0xb6);
+	emit_modrm (0, reg, 4);
+	emit_modrm (0, index, base);
+}
+
+/* mov byte [base + index], r8. r8 must be al, cl or dl */
+
+static void emit_store_byte (int reg, int base, int index)
+{
+	emit_rex (0, reg, index, base);
+	emit8 (0x88);
+	emit_modrm (0, reg, 4);
+	emit_modrm (0, index, base);
+}
+
+/* lea r32, [base + disp32] */
+
+static void emit_lea (int reg, int base, uint32_t disp)
+{
+	emit_rex (0, reg, 0, base);
+	emit8 (0x8d);
+	emit_modrm (2, reg, base);
+	if ((base & 7) == RSP)
+		emit8 (0x24);
+	emit32 (disp);
+}
+
+/* setcc r8, into one of r8b-r11b */
+
+static void emit_setcc (int cc, int reg)
+{
+	emit_rex (0, 0, 0, reg);
+	emit8 (0x0f);
+	emit8 (0x90 + cc);
+	emit_modrm (3, 0, reg);
+}
+
+/* jcc rel8, returning where to patch the offset */
+
+static uint8_t *emit_jcc8 (int cc)
+{
+	emit8 (0x70 + cc);
+	emit8 (0);
+	return jit_p - 1;
+}
+
+static uint8_t *emit_jmp8 (void)
+{
+	emit8 (0xeb);
+	emit8 (0);
+	return jit_p - 1;
+}
+
+static void patch8 (uint8_t *where)
+{
+	*where = jit_p - (where + 1);
+}
+
+/* leave the block: set the PC and return the cycle count */
+
+static void emit_exit (unsigned pc, unsigned cycles)
+{
+	emit_mov_imm (RSI, pc & 0xffff);
+	emit_mov_imm (RDI, cycles);
+	emit8 (0xe9);
+	emit32 (jit_epilogue - (jit_p + 4));
+}
+
+/* the host register holding a 6809 index register */
+
+static int jit_hreg (const unsigned *reg)
+{
+	if (reg == &reg_x)
+		return R12;
+	if (reg == &reg_y)
+		return R13;
+	if (reg == &reg_u)
+		return R14;
+	return R15;
+}
+
+/* copy the 6809 flags we were asked for out of the x86 flags.
+ * This is done in two steps as the x86 flags must be captured
+ * before anything else touches them.
+ */
+
+static void emit_flags_capture (unsigned mask)
+{
+	if (mask & FLAG_N)
+		emit_setcc (CC_S, R8);
+	if (mask & FLAG_Z)
+		emit_setcc (CC_Z, R9);
+	if (mask & FLAG_V)
+		emit_setcc (CC_O, R10);
+	if (mask & FLAG_C)
+		emit_setcc (CC_C, R11);
+}
+
+static void emit_flags_commit (unsigned mask, unsigned zero)
+{
+	static const struct {
+		unsigned flag;
+		int reg;
+		unsigned shift;
+	} bits[4] = {
+		{ FLAG_N, R8, 3 },
+		{ FLAG_Z, R9, 2 },
+		{ FLAG_V, R10, 1 },
+		{ FLAG_C, R11, 0 }
+	};
+	int i;
+
+	emit_alu_imm (ALU_AND, RBP, ~(mask | zero));
+	for (i = 0; i < 4; i++) {
+		if ((mask & bits[i].flag) == 0)
+			continue;
+		/* movzx r32, r8 */
+		emit_rex (0, bits[i].reg, 0, bits[i].reg);
+		emit8 (0x0f);
+		emit8 (0xb6);
+		emit_modrm (3, bits[i].reg, bits[i].reg);
+		if (bits[i].shift)
+			emit_shl (bits[i].reg, bits[i].shift);
+		emit_rr (0, 0x09, RBP, bits[i].reg);
+	}
+}
+
+/* the flags set by a 16-bit load or store of a host register */
+
+static void emit_tst16 (int reg)
+{
+	emit_rr (1, 0x85, reg, reg);
+	emit_flags_capture (FLAG_N | FLAG_Z);
+	emit_flags_commit (FLAG_N | FLAG_Z, FLAG_V);
+}
+
+/* the effective address of a non-immediate operand, into esi */
+
+static void emit_ea (const struct bc_ea *ea)
+{
+	switch (ea->mode) {
+	case BC_DIRECT:
+		emit_movabs (RAX, &reg_dp);
+		emit_load_rax (RSI);
+		emit_shl (RSI, 8);
+		emit_alu_imm (ALU_OR, RSI, ea->val);
+		break;
+	case BC_INDEXED:
+		emit_lea (RSI, jit_hreg (ea->reg), ea->val);
+		break;
+	default:
+		emit_mov_imm (RSI, ea->val);
+		break;
+	}
+	emit_alu_imm (ALU_AND, RSI, 0xffff);
+}
+
+/* read the byte or word at esi into eax. esi is preserved. */
+
+static void emit_read8 (void)
+{
+	emit_movabs (RDX, ram);
+	emit_load_byte (RAX, RDX, RSI);
+}
+
+static void emit_read16 (void)
+{
+	emit_movabs (RDX, ram);
+	emit_load_byte (RAX, RDX, RSI);
+	emit_shl (RAX, 8);
+	emit_lea (RCX, RSI, 1);
+	emit_alu_imm (ALU_AND, RCX, 0xffff);
+	emit_load_byte (RCX, RDX, RCX);
+	emit_rr (0, 0x09, RAX, RCX);
+}
+
+/* an 8 or 16-bit operand into eax */
+
+static void emit_operand8 (const struct bc_ea *ea)
+{
+	if (ea->mode == BC_IMMEDIATE) {
+		emit_mov_imm (RAX, ea->val & 0xff);
+		return;
+	}
+	emit_ea (ea);
+	emit_read8 ();
+}
+
+static void emit_operand16 (const struct bc_ea *ea)
+{
+	if (ea->mode == BC_IMMEDIATE) {
+		emit_mov_imm (RAX, ea->val & 0xffff);
+		return;
+	}
+	emit_ea (ea);
+	emit_read16 ();
+}
+
+/* the slow path for stores */
+
+static void jit_write8 (unsigned address, unsigned data)
+{
+	write8 (address, data);
+}
+
+/* call jit_write8() to write cl to the address in esi */
+
+static void emit_write8_call (void)
+{
+	emit_rr (0, 0x89, RDI, RSI);
+	emit_rr (0, 0x89, RSI, RCX);
+	emit_movabs_imm (RAX, (uintptr_t) jit_write8);
+	/* call rax */
+	emit8 (0xff);
+	emit8 (0xd0);
+}
+
+/* write cl to the address in esi. Everything but the 6809
+ * registers is lost if we have to call jit_write8(). When
+ * jit_checked is set every store is sent there.
+ */
+
+static void emit_write8 (void)
+{
+	uint8_t *mmio, *code, *done;
+
+	if (jit_checked) {
+		emit_write8_call ();
+		return;
+	}
+
+	/* does the page have a write handler? */
+	emit_rr (0, 0x89, RAX, RSI);
+	emit_shr (RAX, 8);
+	emit_movabs (RDX, e6809_page_write);
+	/* cmp qword [rdx + rax * 8], 0 */
+	emit_rex (1, ALU_CMP, RAX, RDX);
+	emit8 (0x83);
+	emit_modrm (0, ALU_CMP, 4);
+	emit_modrm (3, RAX, RDX);
+	emit8 (0);
+	mmio = emit_jcc8 (CC_NZ);
+
+	/* is the byte translated code? */
+	emit_rr (0, 0x89, RAX, RSI);
+	emit_shr (RAX, 3);
+	emit_movabs (RDX, bc_codemap);
+	emit_load_byte (RAX, RDX, RAX);
+	emit_rr (0, 0x89, RDX, RSI);
+	emit_alu_imm (ALU_AND, RDX, 7);
+	/* bt eax, edx */
+	emit8 (0x0f);
+	emit8 (0xa3);
+	emit_modrm (3, RDX, RAX);
+	code = emit_jcc8 (CC_C);
+
+	emit_movabs (RDX, ram);
+	emit_store_byte (RCX, RDX, RSI);
+	done = emit_jmp8 ();
+
+	patch8 (mmio);
+	patch8 (code);
+	emit_write8_call ();
+	patch8 (done);
+}
+
+/* write the low 16 bits of a host register to the address in esi */
+
+static void emit_write16 (int reg)
+{
+	/* mov [rsp], esi */
+	emit8 (0x89);
+	emit8 (0x34);
+	emit8 (0x24);
+	emit_rr (0, 0x89, RCX, reg);
+	emit_shr (RCX, 8);
+	emit_alu_imm (ALU_AND, RCX, 0xff);
+	emit_write8 ();
+
+	/* mov esi, [rsp] */
+	emit8 (0x8b);
+	emit8 (0x34);
+	emit8 (0x24);
+	emit_lea (RSI, RSI, 1);
+	emit_alu_imm (ALU_AND, RSI, 0xffff);
+	emit_rr (0, 0x89, RCX, reg);
+	emit_alu_imm (ALU_AND, RCX, 0xff);
+	emit_write8 ();
+}
+
+/* after a store, leave if the block cache was flushed */
+
+static void emit_gen_check (const struct bc_op *op, unsigned cycles)
+{
+	uint8_t *same;
+
+	emit_movabs (RAX, &bc_gen);
+	emit8 (0x81);
+	emit_modrm (0, ALU_CMP, RAX);
+	emit32 (bc_gen);
+	same = emit_jcc8 (CC_Z);
+	emit_exit (op->next, cycles);
+	patch8 (same);
+}
+
+/* a short branch at the end of the block, using the condition
+ * from bc_branch_test(). We leave by one exit or the other.
+ */
+
+static void emit_branch (const struct bc_op *op, unsigned cycles)
+{
+	unsigned taken = (op->next + op->offset) & 0xffff;
+	uint8_t *skip;
+
+	switch (op->arg & 0xe) {
+	case 0x0:
+		emit_exit ((op->arg & 1) ? op->next : taken, cycles);
+		return;
+	case 0x2:
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_C | FLAG_Z);
+		break;
+	case 0x4:
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_C);
+		break;
+	case 0x6:
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_Z);
+		break;
+	case 0x8:
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_V);
+		break;
+	case 0xa:
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_N);
+		break;
+	default:
+		/* N ^ V, and for bgt/ble also Z */
+		emit_rr (0, 0x89, RAX, RBP);
+		emit_shr (RAX, 2);
+		emit_rr (0, 0x31, RAX, RBP);
+		emit_alu_imm (ALU_AND, RAX, FLAG_V);
+		if ((op->arg & 0xe) == 0xe) {
+			emit_rr (0, 0x89, RCX, RBP);
+			emit_alu_imm (ALU_AND, RCX, FLAG_Z);
+			emit_rr (0, 0x09, RAX, RCX);
+		}
+		break;
+	}
+
+	/* even opcodes branch when the test is false, odd when true */
+	emit_rr (0, 0x85, RAX, RAX);
+	skip = emit_jcc8 ((op->arg & 1) ? CC_Z : CC_NZ);
+	emit_exit (taken, cycles);
+	patch8 (skip);
+	emit_exit (op->next, cycles);
+}
+
+/* compile one translated instruction. Returns 0 if we can't. */
+
+static int jit_op (const struct bc_op *op, unsigned cycles)
+{
+	int reg;
+
+	if (op->func == bc_ldd) {
+		emit_operand16 (&op->ea);
+		emit_rr (0, 0x89, RBX, RAX);
+		emit_tst16 (RBX);
+	} else if (op->func == bc_std) {
+		emit_ea (&op->ea);
+		emit_write16 (RBX);
+		emit_tst16 (RBX);
+		emit_gen_check (op, cycles);
+	} else if (op->func == bc_ld16) {
+		reg = jit_hreg (op->reg);
+		emit_operand16 (&op->ea);
+		emit_rr (0, 0x89, reg, RAX);
+		emit_tst16 (reg);
+	} else if (op->func == bc_st16) {
+		reg = jit_hreg (op->reg);
+		emit_ea (&op->ea);
+		emit_write16 (reg);
+		emit_tst16 (reg);
+		emit_gen_check (op, cycles);
+	} else if (op->func == bc_ld8) {
+		emit_operand8 (&op->ea);
+		/* test al, al */
+		emit8 (0x84);
+		emit_modrm (3, RAX, RAX);
+		emit_flags_capture (FLAG_N | FLAG_Z);
+		if (op->reg == &reg_a) {
+			emit_alu_imm (ALU_AND, RBX, 0x00ff);
+			emit_shl (RAX, 8);
+		} else
+			emit_alu_imm (ALU_AND, RBX, 0xff00);
+		emit_rr (0, 0x09, RBX, RAX);
+		emit_flags_commit (FLAG_N | FLAG_Z, FLAG_V);
+	} else if (op->func == bc_st8) {
+		emit_ea (&op->ea);
+		emit_rr (0, 0x89, RCX, RBX);
+		if (op->reg == &reg_a)
+			emit_shr (RCX, 8);
+		emit_alu_imm (ALU_AND, RCX, 0xff);
+		emit_write8 ();
+		emit_rr (0, 0x89, RCX, RBX);
+		if (op->reg == &reg_a)
+			emit_shr (RCX, 8);
+		/* test cl, cl */
+		emit8 (0x84);
+		emit_modrm (3, RCX, RCX);
+		emit_flags_capture (FLAG_N | FLAG_Z);
+		emit_flags_commit (FLAG_N | FLAG_Z, FLAG_V);
+		emit_gen_check (op, cycles);
+	} else if (op->func == bc_addd || op->func == bc_subd ||
+			   op->func == bc_cmpx || op->func == bc_cmpx_bra8) {
+		emit_operand16 (&op->ea);
+		if (op->func == bc_addd)
+			emit_rr (1, 0x01, RBX, RAX);
+		else if (op->func == bc_subd)
+			emit_rr (1, 0x29, RBX, RAX);
+		else
+			emit_rr (1, 0x39, R12, RAX);
+		emit_flags_capture (FLAG_N | FLAG_Z | FLAG_V | FLAG_C);
+		emit_flags_commit (FLAG_N | FLAG_Z | FLAG_V | FLAG_C, 0);
+		if (op->func == bc_cmpx_bra8)
+			emit_branch (op, cycles);
+	} else if (op->func == bc_lea) {
+		reg = jit_hreg (op->reg);
+		emit_ea (&op->ea);
+		emit_rr (0, 0x89, reg, RSI);
+		if (reg == R12 || reg == R13) {
+			emit_rr (1, 0x85, reg, reg);
+			emit_flags_capture (FLAG_Z);
+			emit_flags_commit (FLAG_Z, 0);
+		}
+	} else if (op->func == bc_bra8) {
+		emit_branch (op, cycles);
+	} else if (op->func == bc_ldd_op_std) {
+		/* the flags from the ldd are all overwritten by the addd */
+		emit_ea (&op->ea);
+		/* mov [rsp], esi */
+		emit8 (0x89);
+		emit8 (0x34);
+		emit8 (0x24);
+		emit_read16 ();
+		emit_rr (0, 0x89, RBX, RAX);
+		emit_operand16 (&op->ea2);
+		emit_rr (1, (op->arg == 0xc3) ? 0x01 : 0x29, RBX, RAX);
+		emit_flags_capture (FLAG_N | FLAG_Z | FLAG_V | FLAG_C);
+		emit_flags_commit (FLAG_N | FLAG_Z | FLAG_V | FLAG_C, 0);
+		/* mov esi, [rsp] */
+		emit8 (0x8b);
+		emit8 (0x34);
+		emit8 (0x24);
+		emit_write16 (RBX);
+		emit_tst16 (RBX);
+		emit_gen_check (op, cycles);
+	} else
+		return 0;
+
+	return 1;
+}
+
+/* the code every native block leaves through. esi holds the new
+ * PC and edi the cycle count.
+ */
+
+static void jit_emit_epilogue (void)
+{
+	static unsigned *regs[] = { &reg_x, &reg_y, &reg_u, &reg_s };
+	static const int hregs[] = { R12, R13, R14, R15 };
+	int i;
+
+	jit_epilogue = jit_p;
+
+	/* mov word [reg_pc], si */
+	emit_movabs (RAX, &reg_pc);
+	emit8 (0x66);
+	emit_store_rax (RSI);
+
+	emit_rr (0, 0x89, RCX, RBX);
+	emit_shr (RCX, 8);
+	emit_movabs (RAX, &reg_a);
+	emit_store_rax (RCX);
+	emit_rr (0, 0x89, RCX, RBX);
+	emit_alu_imm (ALU_AND, RCX, 0xff);
+	emit_movabs (RAX, &reg_b);
+	emit_store_rax (RCX);
+	for (i = 0; i < 4; i++) {
+		emit_movabs (RAX, regs[i]);
+		emit_store_rax (hregs[i]);
+	}
+	emit_movabs (RAX, &reg_cc);
+	emit_store_rax (RBP);
+
+	emit_rr (0, 0x89, RAX, RDI);
+	/* add rsp, 8 ; pop r15 ... rbx ; ret */
+	emit8 (0x48); emit8 (0x83); emit8 (0xc4); emit8 (0x08);
+	emit8 (0x41); emit8 (0x5f);
+	emit8 (0x41); emit8 (0x5e);
+	emit8 (0x41); emit8 (0x5d);
+	emit8 (0x41); emit8 (0x5c);
+	emit8 (0x5d);
+	emit8 (0x5b);
+	emit8 (0xc3);
+}
+
+/* load the 6809 registers into host registers */
+
+static void jit_emit_prologue (void)
+{
+	static unsigned *regs[] = { &reg_x, &reg_y, &reg_u, &reg_s };
+	static const int hregs[] = { R12, R13, R14, R15 };
+	int i;
+
+	/* push rbx, rbp, r12 ... r15 ; sub rsp, 8 */
+	emit8 (0x53);
+	emit8 (0x55);
+	emit8 (0x41); emit8 (0x54);
+	emit8 (0x41); emit8 (0x55);
+	emit8 (0x41); emit8 (0x56);
+	emit8 (0x41); emit8 (0x57);
+	emit8 (0x48); emit8 (0x83); emit8 (0xec); emit8 (0x08);
+
+	emit_movabs (RAX, &reg_a);
+	emit_load_rax (RBX);
+	emit_alu_imm (ALU_AND, RBX, 0xff);
+	emit_shl (RBX, 8);
+	emit_movabs (RAX, &reg_b);
+	emit_load_rax (RCX);
+	emit_alu_imm (ALU_AND, RCX, 0xff);
+	emit_rr (0, 0x09, RBX, RCX);
+	for (i = 0; i < 4; i++) {
+		emit_movabs (RAX, regs[i]);
+		emit_load_rax (hregs[i]);
+		emit_alu_imm (ALU_AND, hregs[i], 0xffff);
+	}
+	emit_movabs (RAX, &reg_cc);
+	emit_load_rax (RBP);
+}
+
+/* empty the code buffer, leaving just the shared epilogue */
+
+static void jit_reset (void)
+{
+	jit_p = jit_buf;
+	jit_emit_epilogue ();
+	jit_gen = bc_gen;
+}
+
+/* compile as much of the block as we can */
+
+static void jit_compile (struct bc_block *blk)
+{
+	uint8_t *start;
+	unsigned cycles = 0;
+	int i;
+
+	if (jit_gen != bc_gen)
+		jit_reset ();
+	if (jit_p + JIT_MAXBLOCK > jit_buf + JIT_SIZE) {
+		/* out of room: start again once this block has run, as
+		 * flushing now would hide its stores to its own code
+		 */
+		jit_full = 1;
+		return;
+	}
+
+	start = jit_p;
+	jit_emit_prologue ();
+	for (i = 0; i < blk->count; i++) {
+		if (!jit_op (&blk->ops[i], cycles + blk->ops[i].cycles))
+			break;
+		cycles += blk->ops[i].cycles;
+		if (blk->ops[i].func == bc_bra8 ||
+			blk->ops[i].func == bc_cmpx_bra8) {
+			i++;
+			break;
+		}
+	}
+
+	if (i == 0 || (i == 1 && blk->ops[0].func == bc_bra8)) {
+		/* not worth it */
+		jit_p = start;
+		return;
+	}
+
+	/* fall out of the end of the compiled instructions */
+	if (blk->ops[i - 1].func != bc_bra8 &&
+		blk->ops[i - 1].func != bc_cmpx_bra8)
+		emit_exit (blk->ops[i - 1].next, cycles);
+
+	/* ISO C has no cast from data to function pointers */
+	memcpy (&blk->native, &start, sizeof (start));
+	blk->nnative = i;
+}
+
+/* called each time a block is run */
+
+static void jit_block (struct bc_block *blk)
+{
+	if (jit_enabled && blk->native == NULL && ++blk->runs == JIT_THRESHOLD)
+		jit_compile (blk);
+}
+
+/* called after each block has run */
+
+static void jit_block_done (void)
+{
+	if (jit_full) {
+		jit_full = 0;
+		bc_flush ();
+	}
+}
+
+/* Turn on native code generation. If checked is set, every store
+ * goes through e6809_write8() so that the lockstep checker sees it.
+ * Returns -1 if the executable buffer could not be allocated.
+ */
+int e6809_enable_jit (int checked)
+{
+	if (jit_buf == NULL) {
+		jit_buf = mmap (NULL, JIT_SIZE, PROT_READ | PROT_WRITE | PROT_EXEC,
+						MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if (jit_buf == MAP_FAILED) {
+			jit_buf = NULL;
+			return -1;
+		}
+	}
+	jit_reset ();
+	jit_enabled = 1;
+	jit_checked = checked;
+	return 0;
+}
@@ -24,6 +24,7 @@
  */
 
 #include <stdint.h>
+#include <stdlib.h>
 #include <errno.h>
 #include "z80.h"
 #include "string.h"
@@ -132,6 +133,46 @@ struct Z80OpcodeTable
 #include "codegen/opcodes_table.h"
 
 
+/* ---------------------------------------------------------
+ *  Basic-block translation cache
+ * ---------------------------------------------------------
+ *
+ * A block is a run of straight-line instructions ending at the
+ * first one which can change the flow of control. Each instruction
+ * is stored as the opcode handler found by walking the prefix tables
+ * plus what the walk did to PC, R and tstates, so replaying a block
+ * never re-fetches or re-decodes an opcode. Operands are still read
+ * by the handlers themselves. Stores to a byte holding a cached
+ * opcode flush the whole cache by bumping the generation number.
+ */
+
+#define BC_MAXOPS	32		/* Most instructions in a block */
+#define BC_ENTRIES	2048		/* Blocks, direct-mapped by start PC */
+
+struct Z80BlockOp
+{
+	Z80OpcodeFunc func;		/* NULL if the opcode is ignored */
+	byte nfetch;			/* Prefix and opcode bytes fetched */
+	byte rinc;			/* Amount R is incremented by */
+	byte offset;			/* Table opcode_offset, e.g. DDCB */
+};
+
+struct Z80Block
+{
+	unsigned gen;			/* Cache generation at translation */
+	ushort start;			/* Address of the first instruction */
+	int count;			/* Number of instructions */
+	struct Z80BlockOp ops[BC_MAXOPS];
+};
+
+struct Z80BlockCache
+{
+	unsigned gen;			/* Bumped on every flush */
+	byte codemap[65536 / 8];	/* Bytes holding cached opcodes */
+	struct Z80Block blocks[BC_ENTRIES];
+};
+
+
 /* ---------------------------------------------------------
  *  Data operations
  * --------------------------------------------------------- 
@@ -140,6 +181,9 @@ static void write8 (Z80Context* ctx, ushort addr, byte val)
 {
 	ctx->tstates += 3;
 	ctx->memWrite(ctx->memParam, addr, val);	
+	if (ctx->bcache != NULL &&
+	    (ctx->bcache->codemap[addr >> 3] & (1 << (addr & 7))))
+		Z80FlushBlockCache(ctx);
 	if (is_breakpoint(addr, BRK_WRITE)) {
           write_brkpt= 1;
           printf("Write at $%04X\n", addr);
@@ -787,6 +831,10 @@ void Z80Execute (Z80Context* ctx)
           /* If we have a new PC from the monitor, set it */
           if (addr != -1)
             ctx->PC= addr & 0xffff;
+
+          /* The monitor may have rewritten code behind our back */
+          if (ctx->bcache != NULL)
+            Z80FlushBlockCache(ctx);
         }
 
 	if (ctx->nmi_req)
@@ -801,11 +849,157 @@ void Z80Execute (Z80Context* ctx)
 }
 
 
+/* Does this instruction end a basic block? Anything which can
+ * load PC does, and so do the repeating block instructions which
+ * step PC back to themselves. EI and DI end a block so that
+ * interrupts are looked at in the right place.
+ */
+static int ends_block(const char* fmt)
+{
+	static const char* enders[] = {
+		"JP", "JR", "CALL", "RET", "RST", "DJNZ", "HALT", "EI", "DI",
+		"LDIR", "LDDR", "CPIR", "CPDR", "INIR", "INDR", "OTIR", "OTDR",
+		NULL
+	};
+	int i;
+
+	for (i = 0; enders[i] != NULL; i++)
+		if (strncmp(fmt, enders[i], strlen(enders[i])) == 0)
+			return 1;
+	return 0;
+}
+
+
+/* Walk the opcode tables for the instruction at PC just as
+ * do_execute() does, but without touching the CPU state.
+ * Returns 1 if the instruction ends a basic block.
+ */
+static int decode_op(Z80Context* ctx, struct Z80BlockOp* op)
+{
+	const struct Z80OpcodeTable* current = &opcodes_main;
+	const struct Z80OpcodeEntry* entries = current->entries;
+	int offset = 0;
+	byte opcode;
+
+	op->nfetch = 0;
+	op->rinc = 0;
+	do
+	{
+		opcode = ctx->memRead(ctx->memParam,
+				      ctx->PC + op->nfetch + offset);
+		op->nfetch++;
+		op->rinc++;
+		if (entries[opcode].func != NULL)
+		{
+			op->func = entries[opcode].func;
+			op->offset = offset;
+			return ends_block(entries[opcode].format);
+		}
+		else if (entries[opcode].table != NULL)
+		{
+			current = entries[opcode].table;
+			entries = current->entries;
+			offset = current->opcode_offset;
+			if (offset > 0)
+				op->rinc--;
+		}
+		else
+		{
+			/* NOP */
+			op->func = NULL;
+			op->offset = 0;
+			return 0;
+		}
+	} while(1);
+}
+
+
+/* Replay one decoded instruction. This has the same effect
+ * on the CPU as do_execute() has for that instruction.
+ */
+static void run_op(Z80Context* ctx, const struct Z80BlockOp* op)
+{
+	ctx->M1PC = ctx->PC;
+	ctx->tstates += 4 * op->nfetch;
+	ctx->R = (ctx->R & 0x80) | ((ctx->R + op->rinc) & 0x7f);
+
+	if (op->func == NULL)
+	{
+		ctx->PC += op->nfetch;
+		return;
+	}
+
+	ctx->PC += op->nfetch - op->offset;
+	if (ctx->trace)
+		ctx->trace(ctx->memParam);
+	op->func(ctx);
+	ctx->PC += op->offset;
+}
+
+
+/* Run the block starting at PC, translating it first if it
+ * is not in the cache. We stop early if an instruction
+ * overwrites cached code, as the rest of the block is stale.
+ */
+static void run_block(Z80Context* ctx)
+{
+	struct Z80BlockCache* bc = ctx->bcache;
+	struct Z80Block* blk = &bc->blocks[ctx->PC % BC_ENTRIES];
+	unsigned gen = bc->gen;
+	struct Z80BlockOp* op;
+	unsigned addr, end;
+	int i, last;
+
+	ctx->defer_int = 0;
+
+	if (blk->gen == gen && blk->start == ctx->PC && blk->count != 0)
+	{
+		for (i = 0; i < blk->count; i++)
+		{
+			run_op(ctx, &blk->ops[i]);
+			if (bc->gen != gen)
+				return;
+		}
+		return;
+	}
+
+	/* Translate the block, executing each instruction as we go */
+	blk->gen = gen;
+	blk->start = ctx->PC;
+	blk->count = 0;
+	for (i = 0; i < BC_MAXOPS; i++)
+	{
+		op = &blk->ops[i];
+		last = decode_op(ctx, op);
+
+		/* Mark the prefix and opcode bytes as cached code */
+		end = ctx->PC + op->nfetch + op->offset;
+		for (addr = ctx->PC; addr < end; addr++)
+			bc->codemap[(addr & 0xffff) >> 3] |= 1 << (addr & 7);
+
+		blk->count = i + 1;
+		run_op(ctx, op);
+		if (bc->gen != gen || last)
+			return;
+	}
+}
+
+
 unsigned Z80ExecuteTStates(Z80Context* ctx, unsigned tstates)
 {
 	ctx->tstates = 0;
 	while (ctx->tstates < tstates)
-		Z80Execute(ctx);
+	{
+		/* Blocks skip the per-instruction breakpoint and
+		 * interrupt checks, so only use them when those
+		 * can't fire.
+		 */
+		if (ctx->bcache != NULL && !ctx->nmi_req && !ctx->int_req &&
+		    !have_breakpoints())
+			run_block(ctx);
+		else
+			Z80Execute(ctx);
+	}
 	return ctx->tstates;
 }
 
@@ -898,6 +1092,43 @@ void Z80RESET (Z80Context* ctx)
 	ctx->defer_int = 0;
 	ctx->exec_int_vector = 0;
 	ctx->M1 = 0;
+	if (ctx->bcache != NULL)
+		Z80FlushBlockCache(ctx);
+}
+
+
+int Z80EnableBlockCache (Z80Context* ctx)
+{
+	if (ctx->bcache == NULL)
+	{
+		ctx->bcache = calloc(1, sizeof(struct Z80BlockCache));
+		if (ctx->bcache == NULL)
+			return -1;
+	}
+	Z80FlushBlockCache(ctx);
+	return 0;
+}
+
+
+void Z80FlushBlockCache (Z80Context* ctx)
+{
+	ctx->bcache->gen++;
+	memset(ctx->bcache->codemap, 0, sizeof(ctx->bcache->codemap));
+}
+
+
+void Z80InvalidateBlockCache (Z80Context* ctx, ushort addr, unsigned len)
+{
+	if (ctx->bcache == NULL)
+		return;
+	for (; len != 0; len--, addr++)
+	{
+		if (ctx->bcache->codemap[addr >> 3] & (1 << (addr & 7)))
+		{
+			Z80FlushBlockCache(ctx);
+			return;
+		}
+	}
 }
 
 
@@ -40,6 +40,10 @@ typedef byte (*Z80DataIn) 	(int param, ushort address);
 typedef void (*Z80DataOut)	(int param, ushort address, byte data);
 
 
+/** The basic-block translation cache. Opaque to users of the library. */
+struct Z80BlockCache;
+
+
 /** 
  * A Z80 register set.
  * An union is used since we want independent access to the high and low bytes of the 16-bit registers.
@@ -135,6 +139,11 @@ typedef struct
 
 	void (*trace)(unsigned int memparam);
 
+	/* If not NULL, Z80ExecuteTStates() runs straight-line code
+	 * from this cache of translated basic blocks. */
+
+	struct Z80BlockCache* bcache;
+
 } Z80Context;
 
 
@@ -154,9 +163,25 @@ unsigned Z80ExecuteTStates(Z80Context* ctx, unsigned tstates);
  */
 void Z80Debug (Z80Context* ctx, char* dump, char* decode);
 
-/** Resets the processor. */
+/** Resets the processor. Flushes the block cache if there is one. */
 void Z80RESET (Z80Context* ctx);
 
+/** Enable the basic-block translation cache for this context.
+ * Straight-line code is translated once into a list of opcode
+ * handlers and replayed by Z80ExecuteTStates(); Z80Execute() still
+ * interprets one instruction at a time. Returns 0 on success or -1
+ * if the cache could not be allocated.
+ */
+int Z80EnableBlockCache (Z80Context* ctx);
+
+/** Discard all translated blocks, e.g. after new code is loaded. */
+void Z80FlushBlockCache (Z80Context* ctx);
+
+/** Tell the cache that len bytes at addr were written from outside
+ * the CPU, e.g. by a system call. Flushes it if any were cached code.
+ */
+void Z80InvalidateBlockCache (Z80Context* ctx, ushort addr, unsigned len);
+
 /** Generates a hardware interrupt.
  * Some interrupt modes read a value from the data bus; this value must be provided in this function call, even
  * if the processor ignores that value in the current interrupt mode.
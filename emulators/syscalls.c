@@ -159,7 +159,10 @@ void print_termios(char *msg, struct termios *t) {
 // - int siarg(int off);			// Get signed int arg
 // - unsigned int uiarg(int off);		// Get unsigned int arg
 // - void putui(uint16_t addr, uint16_t val)	// Put 16-bit value in mem at the given addr
+//						// and call mem_written() on it
 // - uint16_t getui(uint16_t addr)		// Get 16-bit value in emulator mem at addr
+// - void mem_written(uint16_t addr, int len)	// Tell the CPU that len bytes at addr
+//						// were written through get_memptr()
 //
 // Finally, add calls to these functions here in your emulator's code:
 //
@@ -237,10 +240,16 @@ unsigned int ularg(int off) {
   return(val);
 }
 
+// Drop any cached translation of code we have just overwritten
+void mem_written(uint16_t addr, int len) {
+  e6809_invalidate(addr, len);
+}
+
 // Put 16-bit value in memory at the given location
 void putui(uint16_t addr, uint16_t val) {
-  e6809_write8(addr++, val >> 8);
-  e6809_write8(addr, val & 0xff);
+  e6809_write8(addr, val >> 8);
+  e6809_write8(addr+1, val & 0xff);
+  mem_written(addr, 2);
 }
 
 // Get 16-bit value in memory at the given location
@@ -314,10 +323,16 @@ unsigned int ularg(int off) {
   return(val);
 }
 
+// Drop any cached translation of code we have just overwritten
+void mem_written(uint16_t addr, int len) {
+  Z80InvalidateBlockCache(&cpu_z80, addr, len);
+}
+
 // Put 16-bit value in memory at the given location
 void putui(uint16_t addr, uint16_t val) {
-  mem_write(0, addr++, val & 0xff);
-  mem_write(0, addr, val >> 8);
+  mem_write(0, addr, val & 0xff);
+  mem_write(0, addr+1, val >> 8);
+  mem_written(addr, 2);
 }
 
 // Get 16-bit value in memory at the given location
@@ -741,6 +756,8 @@ int do_syscall(int op, int *longresult) {
 	if (buf==NULL) { result=-1; errno=EFAULT; break; }
 	cnt= uiarg(4);
 	result= read(fd, buf, cnt);
+	if (result > 0)
+	  mem_written(uiarg(2), result);
 	break;
     case 8:		// write
 	fd= uiarg(0);
@@ -760,6 +777,7 @@ int do_syscall(int op, int *longresult) {
 	off= lseek(fd, off, whence);
 	// Convert result back to FUZIX endian
 	*ooff= htoemu32((int32_t)(off & 0xffffffff));
+	mem_written(uiarg(2), 4);
 	// Return -1 on error, 0 otherwise
 	if (off==-1)
 	  return(-1);
@@ -799,6 +817,7 @@ int do_syscall(int op, int *longresult) {
 	result= stat(path, &hstat);
 	if (result==-1) break;
 	copystat(&hstat, ustat);
+	mem_written(uiarg(2), sizeof(struct _uzistat));
 	break;
     case 16:		// _fstat
 	fd= uiarg(0);
@@ -807,6 +826,7 @@ int do_syscall(int op, int *longresult) {
 	result= fstat(fd, &hstat);
 	if (result==-1) break;
 	copystat(&hstat, ustat);
+	mem_written(uiarg(2), sizeof(struct _uzistat));
 	break;
     case 17:		// dup
 	fd= uiarg(0);
@@ -884,6 +904,7 @@ int do_syscall(int op, int *longresult) {
 	tim= time(NULL);
 	// Convert to FUZIX endian
 	*ktim= htoemu32((int32_t)tim & 0xffffffff);
+	mem_written(uiarg(0), 4);
 	return(0);
     case 29:		// ioctl. Only a few implemented
 	fd= uiarg(0);
@@ -895,6 +916,7 @@ int do_syscall(int op, int *longresult) {
 	    result= tcgetattr(fd, &termios);
 	    if (result== -1) break;
 	    to_fuzix_termios(ftios, &termios);
+	    mem_written(uiarg(4), sizeof(struct fotermios));
 	    break;
 	  case FO_TCSETSW:
 	    flags= TCSADRAIN;
@@ -937,6 +959,7 @@ setterm:
 	    if (result == -1) break;
     	    fw->ws_row= htoemu16(w.ws_row);
     	    fw->ws_col= htoemu16(w.ws_col);
+	    mem_written(uiarg(4), sizeof(struct fowinsize));
 	    break;
 	  default: fprintf(stderr, "Unimplemented ioctl %d\n", options); exit(1);
 	}
@@ -1068,6 +1091,7 @@ setterm:
 	result= waitpid(pid, &wstatus, options);
 	// Put the status into memory
 	*iptr= htoemu16((int16_t)wstatus & 0xffff);
+	mem_written(uiarg(2), 2);
 	break;
     case 60:		// flock
 	fd= uiarg(0);
@@ -28,6 +28,8 @@ extern struct group *fgetgrent(FILE *__file);
 extern int initgroups(const char *__user, gid_t __gid);
 
 extern struct group * __getgrent(int __grp_fd);
+extern struct group *__grcache(gid_t __gid, const char *__name);
+extern struct group *__grstore(struct group *__gr);
 
 extern char *_path_group;
 
@@ -29,6 +29,8 @@ extern struct passwd *getpwuid(uid_t __uid);
 extern struct passwd *getpwnam(const char *__name);
 
 extern struct passwd * __getpwent(int __passwd_fd);
+extern struct passwd *__pwcache(uid_t __uid, const char *__name);
+extern struct passwd *__pwstore(struct passwd *__pw);
 
 extern char *_path_passwd;
 
@@ -64,11 +64,22 @@ extern FILE stdin[1];
 extern FILE stdout[1];
 extern FILE stderr[1];
 
-#define putc(c, stream)	fputc((c), stream)
-#define getc(stream)	fgetc(stream)
-
-#define putchar(c)	fputc((c), stdout)
-#define getchar()	fgetc(stdin)
+/* Largest buffer fopen will allocate, programs short of memory can lower it */
+extern unsigned int __stdio_bufmax;
+
+/* Work straight on the buffer when we can. fputc() only lets bufwrite past
+   bufstart for a fully buffered stream it is writing, and bufread is only
+   past bufpos when there is read data waiting, so anything else (a mode
+   change, a full or empty buffer, line buffering) goes via the function */
+#define putc(c, stream)	\
+	(((stream)->bufpos >= (stream)->bufwrite) ? fputc((c), (stream)) \
+		: (unsigned char) (*(stream)->bufpos++ = (c)))
+#define getc(stream)	\
+	(((stream)->bufpos >= (stream)->bufread) ? fgetc(stream) \
+		: *(stream)->bufpos++)
+
+#define putchar(c)	putc((c), stdout)
+#define getchar()	getc(stdin)
 
 extern char *gets(char *__s);
 extern char *gets_s(char *__s, size_t __size);
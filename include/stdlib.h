@@ -58,6 +58,9 @@ extern const char *_ultoa(unsigned long __value);
 
 extern char *__ultostr_r(char buf[34], unsigned long value, int __radix);
 extern char *__ltostr_r(char buf[34], long __value, int __radix);
+extern unsigned int __udivmod10(unsigned int *__value);
+extern unsigned int __uldivmod10(unsigned long *__value);
+extern char *__ultodec(char *__end, unsigned long __value);
 
 extern long strtol(const char *__nptr, char **__endptr, int __base);
 extern unsigned long strtoul(const char *__nptr,
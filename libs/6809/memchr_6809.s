@@ -0,0 +1,25 @@
+;
+;	memchr for 6809
+;
+	.export _memchr
+	.code
+
+; void *memchr(const void *s, int c, size_t len)
+_memchr:
+	ldx 2,s		; pointer
+	ldy 6,s		; length
+	beq none
+	ldb 5,s		; byte wanted
+loop:
+	cmpb ,x+
+	beq found
+	leay -1,y
+	bne loop
+none:
+	clra
+	clrb
+	rts
+found:
+	leax -1,x
+	tfr x,d
+	rts
@@ -0,0 +1,29 @@
+;
+;	memcmp for 6809. Bytes compare as unsigned.
+;
+	.export _memcmp
+	.code
+
+; int memcmp(const void *s1, const void *s2, size_t len)
+_memcmp:
+	pshs u
+	ldx 4,s		; s1
+	ldu 6,s		; s2
+	ldy 8,s		; length
+	beq same
+loop:
+	ldb ,x+
+	cmpb ,u+
+	bne diff
+	leay -1,y
+	bne loop
+same:
+	clra
+	clrb
+	puls u,pc
+diff:
+	ldd #1		; carry is still from the cmpb
+	bhs out
+	ldd #-1
+out:
+	puls u,pc
@@ -0,0 +1,30 @@
+;
+;	memcpy for 6809: move a word at a time using the
+;	auto-increment modes, with one leading byte for odd lengths.
+;
+	.export _memcpy
+	.code
+
+; void *memcpy(void *dest, const void *src, size_t len)
+_memcpy:
+	pshs u
+	ldx 4,s		; destination
+	ldu 6,s		; source
+	ldd 8,s		; length
+	lsra
+	rorb		; D = words, carry = odd byte
+	tfr d,y		; count in Y (tfr leaves the carry alone)
+	bcc even
+	lda ,u+
+	sta ,x+
+even:
+	leay ,y		; any words ?
+	beq done
+loop:
+	ldd ,u++
+	std ,x++
+	leay -1,y
+	bne loop
+done:
+	ldd 4,s		; return the destination
+	puls u,pc
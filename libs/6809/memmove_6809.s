@@ -0,0 +1,37 @@
+;
+;	memmove for 6809. Moving down is just a memcpy, moving up
+;	is done a word at a time from the top using pre-decrement.
+;
+	.export _memmove
+	.code
+
+; void *memmove(void *dest, const void *src, size_t len)
+_memmove:
+	ldd 4,s		; source
+	cmpd 2,s	; against destination
+	blo up
+	jmp _memcpy	; same arguments, safe forwards
+up:
+	pshs u
+	ldx 4,s		; destination
+	ldu 6,s		; source
+	ldd 8,s		; length
+	leax d,x	; work from the top end down
+	leau d,u
+	lsra
+	rorb		; D = words, carry = odd byte
+	tfr d,y
+	bcc even
+	lda ,-u
+	sta ,-x
+even:
+	leay ,y
+	beq done
+loop:
+	ldd ,--u
+	std ,--x
+	leay -1,y
+	bne loop
+done:
+	ldd 4,s		; return the destination
+	puls u,pc
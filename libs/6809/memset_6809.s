@@ -0,0 +1,28 @@
+;
+;	memset for 6809: the fill byte goes in both halves of D
+;	so we can store a word at a time.
+;
+	.export _memset
+	.code
+
+; void *memset(void *dest, int c, size_t len)
+_memset:
+	ldd 6,s		; length
+	lsra
+	rorb		; D = words, carry = odd byte
+	tfr d,y
+	ldx 2,s		; destination (loads leave the carry alone)
+	ldb 5,s		; fill byte
+	tfr b,a
+	bcc even
+	stb ,x+
+even:
+	leay ,y
+	beq done
+loop:
+	std ,x++
+	leay -1,y
+	bne loop
+done:
+	ldd 2,s		; return the destination
+	rts
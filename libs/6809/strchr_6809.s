@@ -0,0 +1,21 @@
+;
+;	strchr for 6809. Looking for '\0' finds the terminator.
+;
+	.export _strchr
+	.code
+
+; char *strchr(const char *s, int c)
+_strchr:
+	ldx 2,s
+loop:
+	ldb ,x+
+	cmpb 5,s	; byte wanted
+	beq found
+	tstb
+	bne loop
+	clra		; B is already 0
+	rts
+found:
+	leax -1,x
+	tfr x,d
+	rts
@@ -0,0 +1,24 @@
+;
+;	strcmp for 6809. Characters compare as unsigned.
+;
+	.export _strcmp
+	.code
+
+; int strcmp(const char *s1, const char *s2)
+_strcmp:
+	ldx 2,s		; s1
+	ldy 4,s		; s2
+loop:
+	ldb ,x+
+	cmpb ,y+
+	bne diff
+	tstb		; matched the terminator ?
+	bne loop
+	clra		; B is already 0
+	rts
+diff:
+	ldd #1		; carry is still from the cmpb
+	bhs out
+	ldd #-1
+out:
+	rts
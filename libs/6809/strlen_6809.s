@@ -0,0 +1,16 @@
+;
+;	strlen for 6809
+;
+	.export _strlen
+	.code
+
+; size_t strlen(const char *s)
+_strlen:
+	ldx 2,s
+loop:
+	ldb ,x+
+	bne loop
+	leax -1,x	; back onto the terminator
+	tfr x,d
+	subd 2,s
+	rts
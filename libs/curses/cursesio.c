@@ -15,7 +15,7 @@ int LINES, COLS;
 bool NONL;
 
 char termcap[1024];		/* termcap buffer */
-char tc[200];			/* area to hold string capabilities */
+char tc[256];			/* area to hold string capabilities */
 char *ttytype;			/* terminal type from env */
 static char *arp;		/* pointer for use in tgetstr */
 char *cp;			/* character pointer */
@@ -37,6 +37,11 @@ char *as;			/* alternative charset start */
 char *ae;			/* alternative charset end */
 char *bl;			/* ring the bell */
 char *vb;			/* visual bell */
+char *al;			/* insert line */
+char *dl;			/* delete line */
+char *cs;			/* set scroll region */
+char *sf;			/* scroll forward */
+char *sr;			/* scroll reverse */
 
 /* fatal - report error and die. Never returns */
 void fatal(char *s)
@@ -173,6 +178,11 @@ int setterm(char *type)
   ac = (unsigned char *) tgetstr("ac", &arp);
   bl = tgetstr("bl", &arp);
   vb = tgetstr("vb", &arp);
+  al = tgetstr("al", &arp);
+  dl = tgetstr("dl", &arp);
+  cs = tgetstr("cs", &arp);
+  sf = tgetstr("sf", &arp);
+  sr = tgetstr("sr", &arp);
 
   if (ac) {
 	while (*ac) {
@@ -1,13 +1,19 @@
+#include <stdlib.h>
+#include <string.h>
 #include <curses.h>
 #include "curspriv.h"
 #include <termcap.h>
 
 static WINDOW *twin;		/* used by many routines */
+static int lastattr;		/* attributes the terminal has set */
+static int cmcost;		/* rough length of a cursor motion */
+static unsigned int *oldhash;	/* line hashes for scroll detection */
+static unsigned int *newhash;
 
 /****************************************************************/
 /* Gotoxy() moves the physical cursor to the desired address on */
-/* The screen. We don't optimize here - on a PC, it takes more  */
-/* Time to optimize than to do things directly.                 */
+/* The screen. We don't optimize the motion itself, but we do   */
+/* Skip it when the cursor is already there.                    */
 /****************************************************************/
 
 static void gotoxy(int row, int col );
@@ -15,34 +21,57 @@ static void newattr(int ch );
 static void Putchar(int ch );
 static void clrupdate(WINDOW *scr );
 static void transformline(int lineno);
+static void scrollopt(void);
 
 static void gotoxy(int row, int col)
 {
+  if (row == _cursvar.cursrow && col == _cursvar.curscol)
+	return;
   poscur(row, col);
   _cursvar.cursrow = row;
   _cursvar.curscol = col;
 }
 
-/* Update attributes */
+/* Update attributes, sending only the change. Turning something off
+   means me (which resets the lot) and then putting back what stays,
+   unless it is standout or underline going off with nothing else set
+   and the terminal has se or ue for it. */
 static void newattr(int ch)
 {
-  extern char *me, *as, *ae, *mb, *md, *mr, *so, *us;
-  static int lastattr = 0;
+  extern char *me, *as, *ae, *mb, *md, *mr, *so, *se, *us, *ue;
+  int on, off;
 
-  if (lastattr != (ch &= ATR_MSK)) {
-	lastattr = ch;
+  ch &= ATR_MSK;
+  if (lastattr == ch)
+	return;
+  on = ch & ~lastattr;
+  off = lastattr & ~ch;
+  lastattr = ch;
 
+  if (off & A_ALTCHARSET) {
+	tputs(ae, 1, outc);
+	off &= ~A_ALTCHARSET;
+  }
+  if (off && !(ch & ~A_ALTCHARSET)) {
+	if (off == A_STANDOUT && se) {
+		tputs(se, 1, outc);
+		off = 0;
+	} else if (off == A_UNDERLINE && ue) {
+		tputs(ue, 1, outc);
+		off = 0;
+	}
+  }
+  if (off) {
 	tputs(me, 1, outc);
-	if (ae) tputs(ae, 1, outc);
-
-	if (ch & A_ALTCHARSET)
-		if (as) tputs(as, 1, outc);
-	if (ch & A_BLINK) tputs(mb, 1, outc);
-	if (ch & A_BOLD) tputs(md, 1, outc);
-	if (ch & A_REVERSE) tputs(mr, 1, outc);
-	if (ch & A_STANDOUT) tputs(so, 1, outc);
-	if (ch & A_UNDERLINE) tputs(us, 1, outc);
+	on |= ch;		/* me may have dropped as too */
   }
+
+  if (on & A_ALTCHARSET) tputs(as, 1, outc);
+  if (on & A_BLINK) tputs(mb, 1, outc);
+  if (on & A_BOLD) tputs(md, 1, outc);
+  if (on & A_REVERSE) tputs(mr, 1, outc);
+  if (on & A_STANDOUT) tputs(so, 1, outc);
+  if (on & A_UNDERLINE) tputs(us, 1, outc);
 }
 
 /* Putchar() writes a character, with attributes, to the physical
@@ -59,6 +88,8 @@ static void Putchar(int ch)
   if ((_cursvar.cursrow < LINES) || (_cursvar.curscol < COLS)) {
 	newattr(ch);
 	putchar(ch);
+	/* Past the last column we don't know where the cursor went */
+	_cursvar.curscol++;
   }
 }
 
@@ -86,6 +117,8 @@ static void clrupdate(WINDOW *scr)
   }				/* if */
   newattr(scr->_attrs);
   clrscr();
+  _cursvar.cursrow = 0;		/* cl homes the cursor */
+  _cursvar.curscol = 0;
   scr->_clear = FALSE;
   for (i = 0; i < LINES; i++) {	/* update physical screen */
 	src = w->_line[i];
@@ -108,7 +141,10 @@ static void clrupdate(WINDOW *scr)
 
 /****************************************************************/
 /* Transformline() updates the given physical line to look      */
-/* Like the corresponding line in _cursvar.tmpwin.		*/
+/* Like the corresponding line in _cursvar.tmpwin. Only the     */
+/* Characters that differ are sent, but a short run of matching */
+/* Ones between two changes is rewritten rather than moving the */
+/* Cursor over it.                                              */
 /****************************************************************/
 
 static void transformline(register int lineno)
@@ -117,6 +153,7 @@ static void transformline(register int lineno)
   register int *srcp;
   int x;
   int endx;
+  int n;
 
   x = twin->_minchng[lineno];
   endx = twin->_maxchng[lineno];
@@ -126,11 +163,16 @@ static void transformline(register int lineno)
   while (x <= endx) {
         if (*dstp != *srcp) {
                 gotoxy(lineno, x);
-                while (x <= endx && (*dstp != *srcp)) {
+		do {
 			Putchar(*srcp);
 			*dstp++ = *srcp++;
 			x++;
-		}
+			/* Find the next difference, giving up on matching
+			   characters that would need an attribute change */
+			for (n = 0; x + n <= endx && n < cmcost &&
+			     dstp[n] == srcp[n] &&
+			     (srcp[n] & ATR_MSK) == lastattr; n++);
+		} while (x + n <= endx && n < cmcost && dstp[n] != srcp[n]);
 	} else {
 		*dstp++ = *srcp++;
 		x++;
@@ -140,6 +182,133 @@ static void transformline(register int lineno)
   twin->_maxchng[lineno] = _NO_CHANGE;
 }				/* transformline */
 
+/****************************************************************/
+/* Scrollopt() looks for the changed lines of _cursvar.tmpwin   */
+/* Having moved up or down the screen, as when an editor or     */
+/* Pager scrolls, by matching line hashes. If it finds a shift  */
+/* That saves redrawing enough lines, and the terminal can      */
+/* Scroll a region (cs with sf/sr) or insert and delete lines,  */
+/* It scrolls the physical screen and curscr to match so that   */
+/* Transformline() only has the remaining differences to send.  */
+/****************************************************************/
+
+static unsigned int hashline(register int *p)
+{
+  register unsigned int h = 0;
+  int *e = p + COLS;
+
+  while (p < e)
+	h = (h << 5) + h + *p++;
+  return h;
+}
+
+static void scrollopt(void)
+{
+  extern char *al, *dl, *cs, *sf, *sr;
+  int **lp = curscr->_line;
+  int *p;
+  int top, bot, i, k, n;
+  int best = 1;
+  int bestk = 0;
+  int region, up, down;
+
+  /* Find the band of changed lines */
+  for (top = 0; top < LINES && twin->_minchng[top] == _NO_CHANGE; top++);
+  for (bot = LINES - 1; bot > top && twin->_minchng[bot] == _NO_CHANGE; bot--);
+  if (bot - top < 2)
+	return;
+
+  /* Scroll region, or the whole screen which needs no region set. If
+     the band reaches the bottom we need not put back lines below it */
+  region = cs || (top == 0 && bot == LINES - 1);
+  up = (region && sf) || (dl && (al || bot == LINES - 1));
+  down = (region && sr) || (al && (dl || bot == LINES - 1));
+  if (!up && !down)
+	return;
+
+  if (oldhash == NULL) {
+	oldhash = malloc(2 * LINES * sizeof(unsigned int));
+	if (oldhash == NULL)
+		return;
+	newhash = oldhash + LINES;
+  }
+  for (i = top; i <= bot; i++) {
+	oldhash[i] = hashline(lp[i]);
+	newhash[i] = hashline(twin->_line[i]);
+  }
+
+  /* Try each shift, k > 0 being the text moving up. Only count lines
+     that would otherwise need redrawing */
+  for (k = top - bot + 1; k < bot - top; k++) {
+	if (k == 0 || (k > 0 && !up) || (k < 0 && !down))
+		continue;
+	n = 0;
+	for (i = max(top, top - k); i <= min(bot, bot - k); i++)
+		if (newhash[i] == oldhash[i + k] && newhash[i] != oldhash[i])
+			n++;
+	if (n > best) {
+		best = n;
+		bestk = k;
+	}
+  }
+  if (bestk == 0)
+	return;
+
+  newattr(ATR_NRM);		/* new lines come in with the attributes */
+  k = abs(bestk);
+  if (region && (bestk > 0 ? sf : sr) != NULL) {
+	if (cs) {
+		tputs(tgoto(cs, bot, top), 1, outc);
+		_cursvar.cursrow = -1;	/* cs leaves the cursor undefined */
+	}
+	gotoxy(bestk > 0 ? bot : top, 0);
+	for (i = 0; i < k; i++)
+		tputs(bestk > 0 ? sf : sr, 1, outc);
+	if (cs) {
+		tputs(tgoto(cs, LINES - 1, 0), 1, outc);
+		_cursvar.cursrow = -1;
+	}
+  } else if (bestk > 0) {
+	gotoxy(top, 0);
+	for (i = 0; i < k; i++)
+		tputs(dl, 1, outc);
+	if (bot < LINES - 1) {
+		gotoxy(bot - k + 1, 0);
+		for (i = 0; i < k; i++)
+			tputs(al, 1, outc);
+	}
+  } else {
+	if (bot < LINES - 1) {
+		gotoxy(bot - k + 1, 0);
+		for (i = 0; i < k; i++)
+			tputs(dl, 1, outc);
+	}
+	gotoxy(top, 0);
+	for (i = 0; i < k; i++)
+		tputs(al, 1, outc);
+  }
+
+  /* Move curscr's lines the same way, blanking the ones that came in */
+  while (k--) {
+	if (bestk > 0) {
+		p = lp[top];
+		memmove(lp + top, lp + top + 1, (bot - top) * sizeof(int *));
+		lp[bot] = p;
+	} else {
+		p = lp[bot];
+		memmove(lp + top + 1, lp + top, (bot - top) * sizeof(int *));
+		lp[top] = p;
+	}
+	for (i = 0; i < COLS; i++)
+		p[i] = ' ' | ATR_NRM;
+  }
+  /* And compare the whole band against it */
+  for (i = top; i <= bot; i++) {
+	twin->_minchng[i] = 0;
+	twin->_maxchng[i] = COLS - 1;
+  }
+}
+
 /****************************************************************/
 /* Doupdate() updates the physical screen to look like _curs-   */
 /* Var.tmpwin if curscr is not 'Clear-marked'. Otherwise it     */
@@ -148,6 +317,7 @@ static void transformline(register int lineno)
 
 void doupdate(void)
 {
+  extern char *cm;
   int i;
 
   twin = _cursvar.tmpwin;
@@ -157,6 +327,9 @@ void doupdate(void)
 	if (twin->_clear)
 		clrupdate(twin);
 	else {
+		if (cmcost == 0)
+			cmcost = strlen(tgoto(cm, COLS - 1, LINES - 1));
+		scrollopt();
 		for (i = 0; i < LINES; i++)
 			if (twin->_minchng[i] != _NO_CHANGE)
 				transformline(i);
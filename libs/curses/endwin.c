@@ -10,6 +10,8 @@ int endwin(void)
 	refresh();
 
 	poscur(LINES - 1, 0);
+	_cursvar.cursrow = LINES - 1;
+	_cursvar.curscol = 0;
 
 	tputs(me, 1, outc);
 
@@ -0,0 +1,26 @@
+/*
+ *	Divide by ten without calling the division helpers, which are a
+ *	slow shift and subtract loop on the small processors. The quotient
+ *	is n * 0.8 built from shifts and adds, then divided by 8; it can
+ *	come out one low, which the remainder shows up and we correct.
+ */
+#include <stdlib.h>
+
+/* *np /= 10, returning the remainder */
+unsigned int __udivmod10(unsigned int *np)
+{
+	unsigned int n = *np;
+	unsigned int q, r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q >>= 3;
+	r = n - ((q << 2) + q) * 2;
+	if (r > 9) {
+		q++;
+		r -= 10;
+	}
+	*np = q;
+	return r;
+}
@@ -7,7 +7,31 @@
 /* This is an implementation of the C standard IO package. */ 
     
 #include "stdio-l.h"
-    
+#include <sys/stat.h>
+
+unsigned int __stdio_bufmax = BUFSIZE;
+
+/*
+ * Size the buffer to suit the file. A regular file gets a whole block so
+ * the reads and writes go in block sized pieces (or just the file size if
+ * it is smaller and we are only reading it). Anything else, such as a pipe,
+ * gets BUFSIZ.
+ */
+static unsigned int bufsize(int fd, int mode)
+{
+	struct stat st;
+	unsigned int size = BUFSIZ;
+
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode)) {
+		size = BUFSIZE;
+		if (!(mode & __MODE_WRITE) && st.st_size < BUFSIZE)
+			size = st.st_size < 16 ? 16 : st.st_size;
+	}
+	if (size > __stdio_bufmax)
+		size = __stdio_bufmax;
+	return size;
+}
+
 /*
  * This Fopen is all three of fopen, fdopen and freopen. The macros in
  * stdio.h show the other names.
@@ -19,6 +43,7 @@ FILE * __fopen(const char *fname, int fd, FILE * fp, const char *mode)
 	
 	int fopen_mode = 0;
 	FILE * nfp = 0;
+	unsigned int size;
 	 
 	/* If we've got an fp close the old one (freopen) */ 
 	if (fp) {
@@ -82,21 +107,23 @@ FILE * __fopen(const char *fname, int fd, FILE * fp, const char *mode)
 		fp->next = __IO_list;
 		__IO_list = fp;	/* add to list */
 		fp->mode = __MODE_FREEFIL;
-		if (isatty(fd))
+		if (isatty(fd)) {
 			fp->mode |= _IOLBF;
+			size = BUFSIZ;
+		} else {
 #if _IOFBF
-		else
 			fp->mode |= _IOFBF;
-		
 #endif
-		if ((fp->bufstart = calloc(1, BUFSIZ)) == NULL) {
+			size = bufsize(fd, fopen_mode);
+		}
+		if ((fp->bufstart = malloc(size)) == NULL) {
 			/* Oops, no mem
 			 * Humm, full buffering with a eight(!) byte buffer.
 			 */ 
 			fp->bufstart = (uchar *) fp->unbuf;
 			fp->bufend = (uchar *) fp->unbuf + sizeof(fp->unbuf);
 		} else {
-			fp->bufend = fp->bufstart + BUFSIZ;
+			fp->bufend = fp->bufstart + size;
 			fp->mode |= __MODE_FREEBUF;
 		}
 	}
@@ -29,6 +29,9 @@ getgrgid(const gid_t gid)
   struct group * group;
   int grp_fd;
 
+  if ((group=__grcache(gid, NULL))!=NULL)
+    return group;
+
   if ((grp_fd=open("/etc/group", O_RDONLY))<0)
     return NULL;
 
@@ -36,7 +39,7 @@ getgrgid(const gid_t gid)
     if (group->gr_gid==gid)
       {
 	close(grp_fd);
-	return group;
+	return __grstore(group);
       }
 
   close(grp_fd);
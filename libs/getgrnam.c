@@ -36,6 +36,9 @@ getgrnam(const char * name)
       return NULL;
     }
 
+  if ((group=__grcache(0, name))!=NULL)
+    return group;
+
   if ((grp_fd=open("/etc/group", O_RDONLY))<0)
     return NULL;
 
@@ -43,7 +46,7 @@ getgrnam(const char * name)
     if (!strcmp(group->gr_name, name))
       {
 	close(grp_fd);
-	return group;
+	return __grstore(group);
       }
 
   close(grp_fd);
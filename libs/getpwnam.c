@@ -37,6 +37,9 @@ getpwnam(const char * name)
       return NULL;
     }
 
+  if ((passwd=__pwcache(0, name))!=NULL)
+    return passwd;
+
   if ((passwd_fd=open("/etc/passwd", O_RDONLY))<0)
     return NULL;
 
@@ -44,7 +47,7 @@ getpwnam(const char * name)
     if (!strcmp(passwd->pw_name, name))
       {
 	close(passwd_fd);
-	return passwd;
+	return __pwstore(passwd);
       }	  
 
   close(passwd_fd);
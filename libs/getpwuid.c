@@ -29,6 +29,9 @@ getpwuid(uid_t uid)
   int passwd_fd;
   register struct passwd * passwd;
 
+  if ((passwd=__pwcache(uid, NULL))!=NULL)
+    return passwd;
+
   if ((passwd_fd=open("/etc/passwd", O_RDONLY))<0)
     return NULL;
 
@@ -36,7 +39,7 @@ getpwuid(uid_t uid)
     if (passwd->pw_uid==uid)
       {
 	close(passwd_fd);
-	return passwd;
+	return __pwstore(passwd);
       }
 
   close (passwd_fd);
@@ -0,0 +1,99 @@
+/*
+ *	A small per process cache of group entries for getgrgid and
+ *	getgrnam, along the same lines as pwcache.c. The cache is dropped
+ *	whenever /etc/group changes. As there, slots are allocated once and
+ *	reused in place, never freed, as callers may still be using them.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <grp.h>
+#include <sys/stat.h>
+
+#define NGRCACHE	4
+#define GRSLOT		256	/* Member pointers and strings of one entry */
+
+struct grslot {
+	struct group gr;
+	char buf[GRSLOT];
+};
+
+static struct grslot *cache[NGRCACHE];	/* Most recently used first */
+static uint8_t ncache;			/* Slots holding an entry */
+static time_t mtime;
+
+static char *save(char **pp, const char *s)
+{
+	char *r = *pp;
+	size_t l = strlen(s) + 1;
+
+	memcpy(r, s, l);
+	*pp = r + l;
+	return r;
+}
+
+/* Look up by name, or by gid if name is NULL */
+struct group *__grcache(gid_t gid, const char *name)
+{
+	struct stat st;
+	struct grslot *s;
+	struct group *gr;
+	uint8_t i;
+
+	if (stat("/etc/group", &st) < 0)
+		st.st_mtime = 0;
+	if (st.st_mtime != mtime) {
+		ncache = 0;
+		mtime = st.st_mtime;
+	}
+	for (i = 0; i < ncache; i++) {
+		s = cache[i];
+		gr = &s->gr;
+		if (name ? !strcmp(gr->gr_name, name) : gr->gr_gid == gid) {
+			memmove(cache + 1, cache, i * sizeof(*cache));
+			cache[0] = s;
+			return gr;
+		}
+	}
+	return NULL;
+}
+
+/* Remember an entry just read from the file, in a free slot or over the
+   least recently used one. The member list and then the strings go in the
+   slot's buffer */
+struct group *__grstore(struct group *gr)
+{
+	struct grslot *s;
+	struct group *n;
+	char **mp;
+	char *p;
+	size_t len;
+	int nmem = 0;
+	uint8_t i;
+
+	len = strlen(gr->gr_name) + strlen(gr->gr_passwd) + 2;
+	for (mp = gr->gr_mem; *mp; mp++) {
+		len += strlen(*mp) + 1;
+		nmem++;
+	}
+	if ((nmem + 1) * sizeof(char *) + len > GRSLOT)
+		return gr;
+	i = ncache < NGRCACHE ? ncache : NGRCACHE - 1;
+	if (cache[i] == NULL && (cache[i] = malloc(sizeof(struct grslot))) == NULL)
+		return gr;
+	if (i == ncache)
+		ncache++;
+	s = cache[i];
+	memmove(cache + 1, cache, i * sizeof(*cache));
+	cache[0] = s;
+
+	n = &s->gr;
+	n->gr_mem = (char **)s->buf;
+	p = (char *)(n->gr_mem + nmem + 1);
+	n->gr_name = save(&p, gr->gr_name);
+	n->gr_passwd = save(&p, gr->gr_passwd);
+	n->gr_gid = gr->gr_gid;
+	for (nmem = 0; gr->gr_mem[nmem]; nmem++)
+		n->gr_mem[nmem] = save(&p, gr->gr_mem[nmem]);
+	n->gr_mem[nmem] = NULL;
+	return gr;
+}
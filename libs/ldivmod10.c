@@ -0,0 +1,41 @@
+/*
+ *	32bit divide by ten and decimal conversion. See divmod10.c
+ */
+#include <stdlib.h>
+
+/* *np /= 10, returning the remainder */
+unsigned int __uldivmod10(unsigned long *np)
+{
+	unsigned long n = *np;
+	unsigned long q;
+	unsigned int r;
+
+	q = (n >> 1) + (n >> 2);
+	q += q >> 4;
+	q += q >> 8;
+	q += q >> 16;
+	q >>= 3;
+	/* The remainder is small so the low 16 bits are enough */
+	r = (unsigned int)n - (((unsigned int)q << 2) + (unsigned int)q) * 2;
+	if (r > 9) {
+		q++;
+		r -= 10;
+	}
+	*np = q;
+	return r;
+}
+
+/* Write val in decimal backwards from just before p and return the start.
+   Once it fits in 16 bits we finish off with the cheaper 16bit version */
+char *__ultodec(char *p, unsigned long val)
+{
+	unsigned int i;
+
+	while (val > 0xFFFFUL)
+		*--p = '0' + __uldivmod10(&val);
+	i = (unsigned int)val;
+	do
+		*--p = '0' + __udivmod10(&i);
+	while (i);
+	return p;
+}
@@ -3,6 +3,7 @@
  * under the GNU Library General Public License.
  */
 
+#include <stdlib.h>
 
 const char *_ultoa(unsigned long val)
 {
@@ -11,14 +12,7 @@ const char *_ultoa(unsigned long val)
 
    p = buf+sizeof(buf);
    *--p = '\0';
-
-   do
-   {
-      *--p = '0' + val%10;
-      val/=10;
-   }
-   while(val);
-   return p;
+   return __ultodec(p, val);
 }
 
 const char *_ltoa(long val)
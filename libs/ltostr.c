@@ -5,6 +5,7 @@
  * FIXME: helper for stdio needs to become re-entrant
  */
 
+#include <stdlib.h>
 #include <string.h>
 
 
@@ -18,6 +19,7 @@ char * __ultostr_r(char *buf, unsigned long val, int radix)
 
    p = buf + 34;
    *--p = '\0';
+   if( radix == 10 ) return __ultodec(p, val);
 
    do
    {
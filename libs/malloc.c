@@ -6,6 +6,11 @@
  *	  unsigned
  *	- catch the case of a malloc close to the full size_t overflowing in the
  *	  nblock computation.
+ *
+ *	Small blocks are freed onto a list per size and handed straight back
+ *	out from there, so the common small malloc/free pairs don't walk the
+ *	free list at all. The quick lists are given back to the main free list
+ *	to be merged before we ask the kernel for more memory.
  */
 
 #include <stdlib.h>
@@ -17,6 +22,53 @@ struct memh __mroot = { &__mroot, 0 };
 
 struct memh *__mfreeptr = &__mroot;
 
+struct memh *__mbrktop;
+
+/* Quick lists for blocks of 1 to NQUICK units, including the header */
+#define NQUICK	(64 / sizeof(struct memh) + 1)
+
+static struct memh *quick[NQUICK];
+
+static void release(struct memh *mh)
+{
+	struct memh *p;
+
+	/* Find the free list block that is just before us */
+	for (p = __mfreeptr; !(p < mh && mh < p->next); p = p->next)
+		if (p >= p->next && (p < mh || mh < p->next))
+			break;
+	/* Fix up and if we can merge forward */
+	if (mh + mh->size == p->next) {
+		mh->size += p->next->size;
+		mh->next = p->next->next;
+	} else
+		mh->next = p->next;
+	/* Ditto backwards */
+	if (p + p->size == mh) {
+		p->size += mh->size;
+		p->next = mh->next;
+	} else {
+		p->next = mh;
+	}
+	__mfreeptr = p;
+}
+
+/* Give the quick list blocks back to the free list so they can merge */
+static uint8_t flushquick(void)
+{
+	struct memh **q, *p;
+	uint8_t n = 0;
+
+	for (q = quick; q < quick + NQUICK; q++) {
+		while ((p = *q) != NULL) {
+			*q = p->next;
+			release(p);
+			n = 1;
+		}
+	}
+	return n;
+}
+
 #ifdef USE_SYSMALLOC
 static size_t blksz = 8192;
 #endif
@@ -39,7 +91,7 @@ static struct memh *brkmore(size_t nb)
 		p = memalloc(sz);
 		if (p != (void *)-1) {
 			p->size = sz / sizeof(struct memh);
-			free(p + 1);
+			release(p);
 			/* We only get so many blocks in our table so allocate
 			   progressively bigger chunks */
 			blksz += blksz - (blksz >> 2);
@@ -66,9 +118,10 @@ static struct memh *brkmore(size_t nb)
 	/* Move our break point. Using brk this way avoids the sign problems */
 	if (brk(p + nb))
 		return NULL;
+	__mbrktop = p + nb;
 	/* Fake it as a used block and free it into the free list */
 	p->size = nb;
-	free(p + 1);
+	release(p);
 	return __mfreeptr;
 }
 
@@ -83,6 +136,11 @@ void *malloc(size_t size)
 		return NULL;
 	nblocks /= sizeof(struct memh);
 
+	if (nblocks <= NQUICK && (p = quick[nblocks - 1]) != NULL) {
+		quick[nblocks - 1] = p->next;
+		return (void *) (p + 1);
+	}
+
 	prev = __mfreeptr;
 
 	for (p = prev->next;; prev = p, p = p->next) {
@@ -104,7 +162,9 @@ void *malloc(size_t size)
 		}
 		/* We've done one orbit.. */
 		if (p == __mfreeptr) {
-			if ((p = brkmore(nblocks)) == NULL)
+			if (flushquick())
+				p = __mfreeptr;
+			else if ((p = brkmore(nblocks)) == NULL)
 				return NULL;
 		}
 	}
@@ -112,27 +172,15 @@ void *malloc(size_t size)
 
 void free(void *ptr)
 {
-	struct memh *mh = MH(ptr), *p;
+	struct memh *mh = MH(ptr);
 
 	if (ptr == NULL)
 		return;
 
-	/* Find the free list block that is just before us */
-	for (p = __mfreeptr; !(p < mh && mh < p->next); p = p->next)
-		if (p >= p->next && (p < mh || mh < p->next))
-			break;
-	/* Fix up and if we can merge forward */
-	if (mh + mh->size == p->next) {
-		mh->size += p->next->size;
-		mh->next = p->next->next;
-	} else
-		mh->next = p->next;
-	/* Ditto backwards */
-	if (p + p->size == mh) {
-		p->size += mh->size;
-		p->next = mh->next;
-	} else {
-		p->next = mh;
+	if (mh->size <= NQUICK) {
+		mh->next = quick[mh->size - 1];
+		quick[mh->size - 1] = mh;
+		return;
 	}
-	__mfreeptr = p;
+	release(mh);
 }
@@ -7,6 +7,7 @@ struct memh {
 
 extern struct memh __mroot;
 extern struct memh *__mfreeptr;
+extern struct memh *__mbrktop;	/* Where we last put the break */
 
 #define MH(p)	(((struct memh *)(p)) - 1)
 #define BRKSIZE	(512 / sizeof(struct memh))
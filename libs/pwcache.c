@@ -0,0 +1,97 @@
+/*
+ *	A small per process cache of passwd entries for getpwuid and
+ *	getpwnam. Programs such as ls -l ask about the same few users over
+ *	and over, and each miss costs a pass over /etc/passwd at two system
+ *	calls a line. The cache is dropped whenever /etc/passwd changes.
+ *
+ *	Callers may still hold a pointer we returned earlier, so an entry's
+ *	memory is never freed. Each slot is allocated once, big enough for
+ *	any line __getpwent will read, and then reused in place.
+ */
+#include <stdlib.h>
+#include <string.h>
+#include <pwd.h>
+#include <sys/stat.h>
+
+#define NPWCACHE	4
+#define PWSLOT		256	/* Strings of one entry, as __getpwent */
+
+struct pwslot {
+	struct passwd pw;
+	char buf[PWSLOT];
+};
+
+static struct pwslot *cache[NPWCACHE];	/* Most recently used first */
+static uint8_t ncache;			/* Slots holding an entry */
+static time_t mtime;
+
+static char *save(char **pp, const char *s)
+{
+	char *r = *pp;
+	size_t l = strlen(s) + 1;
+
+	memcpy(r, s, l);
+	*pp = r + l;
+	return r;
+}
+
+/* Look up by name, or by uid if name is NULL */
+struct passwd *__pwcache(uid_t uid, const char *name)
+{
+	struct stat st;
+	struct pwslot *s;
+	struct passwd *pw;
+	uint8_t i;
+
+	if (stat("/etc/passwd", &st) < 0)
+		st.st_mtime = 0;
+	if (st.st_mtime != mtime) {
+		ncache = 0;
+		mtime = st.st_mtime;
+	}
+	for (i = 0; i < ncache; i++) {
+		s = cache[i];
+		pw = &s->pw;
+		if (name ? !strcmp(pw->pw_name, name) : pw->pw_uid == uid) {
+			memmove(cache + 1, cache, i * sizeof(*cache));
+			cache[0] = s;
+			return pw;
+		}
+	}
+	return NULL;
+}
+
+/* Remember an entry just read from the file, in a free slot or over the
+   least recently used one. If it won't fit or we can't get the memory we
+   just don't cache it */
+struct passwd *__pwstore(struct passwd *pw)
+{
+	struct pwslot *s;
+	struct passwd *n;
+	uint8_t i;
+	char *p;
+
+	if (strlen(pw->pw_name) + strlen(pw->pw_passwd) +
+		strlen(pw->pw_gecos) + strlen(pw->pw_dir) +
+		strlen(pw->pw_shell) + 5 > PWSLOT)
+		return pw;
+	i = ncache < NPWCACHE ? ncache : NPWCACHE - 1;
+	if (cache[i] == NULL && (cache[i] = malloc(sizeof(struct pwslot))) == NULL)
+		return pw;
+	if (i == ncache)
+		ncache++;
+	s = cache[i];
+	memmove(cache + 1, cache, i * sizeof(*cache));
+	cache[0] = s;
+
+	n = &s->pw;
+	p = s->buf;
+	n->pw_name = save(&p, pw->pw_name);
+	n->pw_passwd = save(&p, pw->pw_passwd);
+	n->pw_uid = pw->pw_uid;
+	n->pw_gid = pw->pw_gid;
+	n->pw_gecos = save(&p, pw->pw_gecos);
+	n->pw_dir = save(&p, pw->pw_dir);
+	n->pw_shell = save(&p, pw->pw_shell);
+	return pw;
+}
@@ -1,157 +1,188 @@
 /*
- * This file lifted in toto from 'Dlibs' on the atari ST  (RdeBath)
+ *	qsort - non recursive introsort
  *
- * 
- *    Dale Schumacher                         399 Beacon Ave.
- *    (alias: Dalnefre')                      St. Paul, MN  55104
- *    dal@syntel.UUCP                         United States of America
- *  "It's not reality that's important, but how you perceive things."
+ *	Median of three quicksort with an explicit stack. The larger side
+ *	of each partition is stacked and the smaller one sorted next, so
+ *	the stack never holds more than log2(n) ranges. Small ranges are
+ *	left for a final insertion sort pass and a range that partitions
+ *	badly too many times is finished with heapsort, so the worst case
+ *	is n log n rather than n^2.
+ *
+ *	Elements are exchanged in place so there is no record size limit
+ *	and no temporary buffer. Two and four byte elements, which are most
+ *	of what gets sorted (pointers, ints, longs), get their own swaps.
+ *
+ *	Replaces the Dlibs quicksort (Dale Schumacher, via RdeBath).
  */
 
-/*
- * Sun Feb  8 21:02:15 EST 1998 claudio@pos.inf.ufpr.br (Claudio Matsuoka)
- * Changed sort direction
- */
+#include <stdlib.h>
 
-#include <string.h>
+/* No longer used but still declared in stdlib.h */
+void *_qbuf;
 
-char *_qbuf = 0;		/* pointer to storage for qsort() */
+/* Ranges this small are left for the insertion sort pass */
+#define THRESH		8
 
-#define	PIVOT			((i+j)>>1)
-#define moveitem(dst,src,size)	if(dst != src) memcpy(dst, src, size)
+/* Enough for any range a size_t can count */
+#define STACKSIZE	(8 * sizeof(size_t))
 
-static void _wqsort(void *basep, int lo, int hi,
-               int (*cmp)(const void *, const void *))
+static void swap(char *a, char *b, size_t size)
 {
-   int   k;
-   register int i, j, t;
-   register int *p = &k;
-   short *base = basep;
-
-   while (hi > lo)
-   {
-      i = lo;
-      j = hi;
-      t = PIVOT;
-      *p = base[t];
-      base[t] = base[i];
-      base[i] = *p;
-      while (i < j)
-      {
-	 while (((*cmp) ((base + j), p)) > 0)
-	    --j;
-	 base[i] = base[j];
-	 while ((i < j) && (((*cmp) ((base + i), p)) <= 0))
-	    ++i;
-	 base[j] = base[i];
-      }
-      base[i] = *p;
-      if ((i - lo) < (hi - i))
-      {
-	 _wqsort(base, lo, (i - 1), cmp);
-	 lo = i + 1;
-      }
-      else
-      {
-	 _wqsort(base, (i + 1), hi, cmp);
-	 hi = i - 1;
-      }
-   }
+	char t;
+
+	if (size == 2) {
+		uint16_t s = *(uint16_t *)a;
+		*(uint16_t *)a = *(uint16_t *)b;
+		*(uint16_t *)b = s;
+	} else if (size == 4) {
+		uint32_t l = *(uint32_t *)a;
+		*(uint32_t *)a = *(uint32_t *)b;
+		*(uint32_t *)b = l;
+	} else if (size == sizeof(long)) {
+		long l = *(long *)a;
+		*(long *)a = *(long *)b;
+		*(long *)b = l;
+	} else {
+		while (size--) {
+			t = *a;
+			*a++ = *b;
+			*b++ = t;
+		}
+	}
 }
 
-static void _lqsort(long *base, int lo, int hi, int (*cmp)(const void *, const void *))
+/* Push element n of the heap at base down until the heap is in order */
+static void siftdown(char *base, size_t n, size_t num, size_t size,
+		     cmp_func_t cmp)
 {
-   long  k;
-   register int i, j, t;
-   register long *p = &k;
-
-   while (hi > lo)
-   {
-      i = lo;
-      j = hi;
-      t = PIVOT;
-      *p = base[t];
-      base[t] = base[i];
-      base[i] = *p;
-      while (i < j)
-      {
-	 while (((*cmp) ((base + j), p)) > 0)
-	    --j;
-	 base[i] = base[j];
-	 while ((i < j) && (((*cmp) ((base + i), p)) <= 0))
-	    ++i;
-	 base[j] = base[i];
-      }
-      base[i] = *p;
-      if ((i - lo) < (hi - i))
-      {
-	 _lqsort(base, lo, (i - 1), cmp);
-	 lo = i + 1;
-      }
-      else
-      {
-	 _lqsort(base, (i + 1), hi, cmp);
-	 hi = i - 1;
-      }
-   }
+	size_t c;
+
+	while ((c = 2 * n + 1) < num) {
+		if (c + 1 < num
+		    && cmp(base + c * size, base + (c + 1) * size) < 0)
+			c++;
+		if (cmp(base + n * size, base + c * size) >= 0)
+			return;
+		swap(base + n * size, base + c * size, size);
+		n = c;
+	}
 }
 
-static void _nqsort(void *basep, int lo, int hi, int size,
-	       int (*cmp)(const void *, const void *))
+static void heapsort(char *base, size_t num, size_t size, cmp_func_t cmp)
 {
-   register int i, j;
-   register char *p = _qbuf;
-   char *base = basep;
-
-   while (hi > lo)
-   {
-      i = lo;
-      j = hi;
-      p = (base + size * PIVOT);
-      moveitem(_qbuf, p, size);
-      moveitem(p, (base + size * i), size);
-      moveitem((base + size * i), _qbuf, size);
-      p = _qbuf;
-      while (i < j)
-      {
-	 while (((*cmp) ((base + size * j), p)) > 0)
-	    --j;
-	 moveitem((base + size * i), (base + size * j), size);
-	 while ((i < j) && (((*cmp) ((base + size * i), p)) <= 0))
-	    ++i;
-	 moveitem((base + size * j), (base + size * i), size);
-      }
-      moveitem((base + size * i), p, size);
-      if ((i - lo) < (hi - i))
-      {
-	 _nqsort(base, lo, (i - 1), size, cmp);
-	 lo = i + 1;
-      }
-      else
-      {
-	 _nqsort(base, (i + 1), hi, size, cmp);
-	 hi = i - 1;
-      }
-   }
+	size_t n = num / 2;
+
+	while (n)
+		siftdown(base, --n, num, size, cmp);
+	while (--num) {
+		swap(base, base + num * size, size);
+		siftdown(base, 0, num, size, cmp);
+	}
 }
 
-void qsort(void *base, size_t num, size_t size,
-	  int (*cmp)(const void *,const void *))
+void qsort(void *basep, size_t num, size_t size, cmp_func_t cmp)
 {
-   char  _qtemp[128];
-
-   if (_qbuf == 0)
-   {
-      if (size > sizeof(_qtemp))/* records too large! */
-	 return;
-      _qbuf = _qtemp;
-   }
-   if (size == 2)
-      _wqsort(base, 0, num - 1, cmp);
-   else if (size == 4)
-      _lqsort(base, 0, num - 1, cmp);
-   else
-      _nqsort(base, 0, num - 1, size, cmp);
-   if (_qbuf == _qtemp)
-      _qbuf = 0;
+	struct {
+		char *lo;
+		size_t n;
+		unsigned char depth;
+	} stack[STACKSIZE], *sp = stack;
+	char *base = basep;
+	char *lo, *mid, *hi, *i, *j, *end;
+	size_t n, nl;
+	unsigned char depth;
+
+	if (num < 2 || size == 0)
+		return;
+
+	/* Allow 2 * log2(num) partitions on any path before giving up */
+	depth = 0;
+	for (n = num; n; n >>= 1)
+		depth += 2;
+
+	lo = base;
+	n = num;
+	for (;;) {
+		if (n <= THRESH) {
+			if (sp == stack)
+				break;
+			--sp;
+			lo = sp->lo;
+			n = sp->n;
+			depth = sp->depth;
+			continue;
+		}
+		if (depth-- == 0) {
+			/* Partitioning is going badly, finish this range
+			   off another way and pick up the next */
+			heapsort(lo, n, size, cmp);
+			n = 0;
+			continue;
+		}
+
+		/* Order lo, mid and hi and put the median in lo. hi then
+		   stops the upward scan and the pivot stops the downward one */
+		hi = lo + (n - 1) * size;
+		mid = lo + (n >> 1) * size;
+		if (cmp(mid, lo) < 0)
+			swap(mid, lo, size);
+		if (cmp(hi, mid) < 0) {
+			swap(hi, mid, size);
+			if (cmp(mid, lo) < 0)
+				swap(mid, lo, size);
+		}
+		swap(lo, mid, size);
+
+		i = lo;
+		j = hi;
+		nl = 0;
+		for (;;) {
+			do {
+				i += size;
+				nl++;
+			} while (cmp(i, lo) < 0);
+			do {
+				j -= size;
+			} while (cmp(lo, j) < 0);
+			if (i >= j)
+				break;
+			swap(i, j, size);
+		}
+		/* j is the last element not above the pivot, so that is
+		   where the pivot goes. Work out how many sit below it */
+		if (i != j)
+			nl--;
+		swap(lo, j, size);
+
+		/* nl elements below the pivot at j, n - nl - 1 above it.
+		   Stack the larger and carry on with the smaller */
+		if (nl < n - nl - 1) {
+			sp->lo = j + size;
+			sp->n = n - nl - 1;
+			n = nl;
+		} else {
+			sp->lo = lo;
+			sp->n = nl;
+			lo = j + size;
+			n = n - nl - 1;
+		}
+		sp->depth = depth;
+		if (sp->n > THRESH)
+			sp++;
+	}
+
+	/* Everything is now within THRESH of its place, or sorted. A
+	   straight insertion sort finishes it off. The first THRESH + 1
+	   elements include the smallest so it acts as a sentinel */
+	end = base + num * size;
+	n = num > THRESH + 1 ? THRESH + 1 : num;
+	mid = base;
+	for (i = base + size; i < base + n * size; i += size)
+		if (cmp(i, mid) < 0)
+			mid = i;
+	if (mid != base)
+		swap(mid, base, size);
+	for (i = base + 2 * size; i < end; i += size)
+		for (j = i; cmp(j - size, j) > 0; j -= size)
+			swap(j - size, j, size);
 }
@@ -14,6 +14,77 @@
 #include <string.h>
 #include "malloc.h"
 
+/*
+ * Try and grow a block where it is. We can take all or part of a free block
+ * that follows us, and if we are the last thing before the break (or a free
+ * block that is) we can move the break up.
+ */
+static int grow(struct memh *mh, size_t nblocks)
+{
+	struct memh *p, *next = mh + mh->size;
+	struct memh *n;
+	size_t avail = 0;
+#ifndef USE_SYSMALLOC
+	size_t more;
+	uintptr_t top;
+#endif
+
+	/* Find the free list block that is just before us */
+	for (p = __mfreeptr; !(p < mh && mh < p->next); p = p->next)
+		if (p >= p->next && (p < mh || mh < p->next))
+			break;
+	if (p->next == next)
+		avail = next->size;
+
+	if (mh->size + avail >= nblocks) {
+		avail = nblocks - mh->size;
+		if (next->size == avail)
+			p->next = next->next;
+		else {
+			/* Split the free block, keeping the top part free */
+			n = next + avail;
+			n->next = next->next;
+			n->size = next->size - avail;
+			p->next = n;
+		}
+	}
+#ifndef USE_SYSMALLOC
+	/* Only ask the kernel if we were last when we last moved the break */
+	else if (next + avail == __mbrktop && __mbrktop == sbrk(0)) {
+		/* Move the break by at least BRKSIZE so that a block that keeps
+		   growing doesn't make a syscall every time */
+		more = nblocks - mh->size - avail;
+		if (more < BRKSIZE)
+			more = BRKSIZE;
+		top = (uintptr_t)__mbrktop + more * sizeof(struct memh);
+		/* Overflow catch */
+		if (top < (uintptr_t)mh)
+			return 0;
+		if (brk((void *)top)) {
+			top = (uintptr_t)(mh + nblocks);
+			if (brk((void *)top))
+				return 0;
+		}
+		__mbrktop = (struct memh *)top;
+		if (avail)
+			p->next = next->next;
+		/* Anything left over goes on the free list after us */
+		n = mh + nblocks;
+		if (n != __mbrktop) {
+			n->size = __mbrktop - n;
+			n->next = p->next;
+			p->next = n;
+		}
+	}
+#endif
+	else
+		return 0;
+	mh->size = nblocks;
+	/* The free block we took may have been the search start */
+	__mfreeptr = p;
+	return 1;
+}
+
 /*
  * We cannot just free/malloc because there is a pathalogical case when we free
  * a block which is merged with the block before and then we allocate some of the
@@ -34,20 +105,23 @@ void *realloc(void *ptr, size_t size)
 	if (ptr == NULL)
 		return malloc(size);
 
-	nblocks =
-	    (size + sizeof(struct memh) + sizeof(struct memh) -
-	     1) / sizeof(struct memh);
+	nblocks = size + sizeof(struct memh) + sizeof(struct memh) - 1;
+	/* Cheap way to catch overflow */
+	if (nblocks < size)
+		return NULL;
+	nblocks /= sizeof(struct memh);
 
 	/* If size in mem blocks is sufficiently similar (make this fuzzier ?) */
-	if (nblocks == mh->size)
+	if (nblocks <= mh->size)
 		return ptr;
 
-	if (nblocks < mh->size)
+	if (grow(mh, nblocks))
 		return ptr;
+
 	np = malloc(size);
 	if (np == NULL)
-		return ptr;
-	memcpy(np, ptr, mh->size * sizeof(struct memh));
+		return NULL;
+	memcpy(np, ptr, (mh->size - 1) * sizeof(struct memh));
 	free(ptr);
 	return np;
 }
@@ -40,6 +40,9 @@
 #include <stdlib.h>
 #include <ctype.h>
 #include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
 extern char *capab;		/* the capability itself */
 
@@ -52,6 +55,73 @@ extern char *UP;		/* up cursor movement */
 #endif
 
 
+/*
+ *	The compiled database made by mktermcap. See cmds/simple/mktermcap.c
+ *	for the layout; all the numbers are 16bit little endian.
+ */
+#define TCDB		"/etc/termcap.db"
+#define TCDB_MAGIC	"tcb1"
+
+static unsigned int get16(const unsigned char *p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+/*
+ *	tgetdb - look the terminal up in the compiled database, using bp
+ *	as the work space. Returns 1 with the entry in bp if found, or 0
+ *	if it is not there, there is no database, or the database is older
+ *	than /etc/termcap and so may be out of date.
+ */
+
+static int tgetdb(char *bp, const char *name, short len)
+{
+    unsigned char *ub = (unsigned char *) bp;
+    uint16_t h = 0;
+    const char *p;
+    unsigned int off;
+    unsigned int n;
+    struct stat db, st;
+    int fd;
+    int found = 0;
+
+    if (len > 255 || (fd = open(TCDB, O_RDONLY)) == -1)
+	return (0);
+    if (fstat(fd, &db) == -1 || (stat("/etc/termcap", &st) == 0
+				  && st.st_mtime > db.st_mtime))
+	goto out;
+    if (read(fd, bp, 6) != 6 || memcmp(bp, TCDB_MAGIC, 4) != 0
+	|| (n = get16(ub + 4)) == 0)
+	goto out;
+    for (p = name; *p; p++)
+	h = h * 33 + (unsigned char) *p;
+    if (lseek(fd, 6L + 2 * (h % n), SEEK_SET) == -1 || read(fd, bp, 2) != 2)
+	goto out;
+
+    /* Walk the bucket: each record is next, entry, len, name */
+    off = get16(ub);
+    while (off) {
+	if (lseek(fd, (off_t) off, SEEK_SET) == -1
+	    || read(fd, bp, 5 + len) != 5 + len)
+	    goto out;
+	if (ub[4] == len && memcmp(bp + 5, name, len) == 0)
+	    break;
+	off = get16(ub);
+    }
+    if (off == 0)
+	goto out;
+    off = get16(ub + 2);
+    if (lseek(fd, (off_t) off, SEEK_SET) == -1 || read(fd, bp, 2) != 2)
+	goto out;
+    n = get16(ub);
+    if (n > 1024 || read(fd, bp, n) != n)
+	goto out;
+    found = 1;
+out:
+    close(fd);
+    return (found);
+}
+
 /*
  *	tgetent - get the termcap entry for terminal name, and put it
  *	in bp (which must be an array of 1024 chars). Returns 1 if
@@ -83,6 +153,11 @@ int tgetent(char *bp, const char *name)
 	    file = "/etc/termcap";
     }
 
+    /* Try the compiled database before scanning the text file */
+    if (strcmp(file, "/etc/termcap") == 0 &&
+	tgetdb(bp, name, len))
+	return (1);
+
     if ((fp = fopen(file, "r")) == (FILE *) NULL) {
 	capab = (char *) NULL;	/* no valid termcap  */
 	return (-1);
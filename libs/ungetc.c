@@ -10,8 +10,10 @@ int ungetc(int c, FILE *fp)
    if ((fp->mode & (__MODE_READ | __MODE_ERR)) != __MODE_READ)
       return EOF;
 
-   /* Can't do fast fseeks */
+   /* Can't do fast fseeks. A pushed back character also ends EOF, and
+      getc() would hand it back without looking anyway */
    fp->mode |= __MODE_UNGOT;
+   fp->mode &= ~__MODE_EOF;
 
    if( fp->bufpos > fp->bufstart )
       return *--fp->bufpos = (unsigned char) c;
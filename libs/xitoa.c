@@ -13,14 +13,11 @@ static char buf[7];
 const char *_uitoa(unsigned int i)
 {
 	char *p = buf + sizeof(buf);
-	int c;
 
 	*--p = '\0';
-	do {
-		c = i % 10;
-		i /= 10;
-		*--p = '0' + c;
-	} while(i);
+	do
+		*--p = '0' + __udivmod10(&i);
+	while(i);
 	return p;
 }
 
@@ -0,0 +1,33 @@
+;
+;	memchr for Z80 using CPIR
+;
+		.export _memchr
+		.code
+
+_memchr:
+		push	bc
+		ld	hl,9
+		add	hl,sp
+		ld	b,(hl)
+		dec	hl
+		ld	c,(hl)		; BC = length
+		dec	hl
+		dec	hl		; skip byte high
+		ld	e,(hl)		; E = byte wanted
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = pointer
+		ld	a,b
+		or	c
+		jr	z,none
+		ld	a,e
+		cpir
+		dec	hl		; CPIR leaves HL past the match
+		jr	z,found
+none:
+		ld	hl,0
+found:
+		pop	bc
+		ret
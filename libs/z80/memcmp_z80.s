@@ -0,0 +1,46 @@
+;
+;	memcmp for Z80. Bytes compare as unsigned.
+;
+		.export _memcmp
+		.code
+
+_memcmp:
+		push	bc
+		ld	hl,9
+		add	hl,sp
+		ld	b,(hl)
+		dec	hl
+		ld	c,(hl)		; BC = length
+		dec	hl
+		ld	d,(hl)
+		dec	hl
+		ld	e,(hl)		; DE = s2
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = s1
+		ld	a,b
+		or	c
+		jr	z,same
+next:
+		ld	a,(de)
+		cpi			; HL++ BC--, Z on match, PE if BC != 0
+		jr	nz,diff
+		inc	de
+		jp	pe,next
+same:
+		ld	hl,0
+		pop	bc
+		ret
+diff:
+		dec	hl		; CPI does not set carry usefully
+		ld	a,(hl)		; so compare again the other way
+		ex	de,hl
+		cp	(hl)
+		ld	hl,1
+		jr	nc,out
+		ld	hl,-1
+out:
+		pop	bc
+		ret
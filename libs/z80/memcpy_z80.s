@@ -0,0 +1,32 @@
+;
+;	memcpy for Z80 using LDIR
+;
+		.export _memcpy
+		.code
+
+_memcpy:
+		push	bc
+		ld	hl,9
+		add	hl,sp
+		ld	b,(hl)
+		dec	hl
+		ld	c,(hl)		; BC = length
+		dec	hl
+		ld	d,(hl)
+		dec	hl
+		ld	e,(hl)		; DE = source
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = destination
+		ld	a,b
+		or	c
+		jr	z,done		; LDIR would move 64K
+		push	hl		; return value
+		ex	de,hl
+		ldir
+		pop	hl
+done:
+		pop	bc
+		ret
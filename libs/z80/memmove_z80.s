@@ -0,0 +1,47 @@
+;
+;	memmove for Z80: LDIR when moving down, LDDR from the top end
+;	when the destination is above the source.
+;
+		.export _memmove
+		.code
+
+_memmove:
+		push	bc
+		ld	hl,9
+		add	hl,sp
+		ld	b,(hl)
+		dec	hl
+		ld	c,(hl)		; BC = length
+		dec	hl
+		ld	d,(hl)
+		dec	hl
+		ld	e,(hl)		; DE = source
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = destination
+		ld	a,b
+		or	c
+		jr	z,done
+		push	hl		; return value
+		ex	de,hl		; HL = source, DE = destination
+		or	a
+		sbc	hl,de
+		add	hl,de		; carry set if source < destination
+		jr	c,up
+		ldir
+		jr	out
+up:
+		add	hl,bc
+		dec	hl		; last source byte
+		ex	de,hl
+		add	hl,bc
+		dec	hl		; last destination byte
+		ex	de,hl
+		lddr
+out:
+		pop	hl
+done:
+		pop	bc
+		ret
@@ -0,0 +1,38 @@
+;
+;	memset for Z80: set the first byte and then LDIR it along
+;
+		.export _memset
+		.code
+
+_memset:
+		push	bc
+		ld	hl,9
+		add	hl,sp
+		ld	b,(hl)
+		dec	hl
+		ld	c,(hl)		; BC = length
+		dec	hl
+		dec	hl		; skip fill high
+		ld	e,(hl)		; E = fill byte
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = destination
+		push	hl		; return value
+		ld	a,b
+		or	c
+		jr	z,done
+		ld	(hl),e
+		dec	bc
+		ld	a,b
+		or	c
+		jr	z,done
+		ld	d,h
+		ld	e,l
+		inc	de
+		ldir			; copy each byte onto the next
+done:
+		pop	hl
+		pop	bc
+		ret
@@ -0,0 +1,25 @@
+;
+;	strchr for Z80. Looking for '\0' finds the terminator.
+;
+		.export _strchr
+		.code
+
+_strchr:
+		ld	hl,4
+		add	hl,sp
+		ld	e,(hl)		; E = byte wanted
+		dec	hl
+		ld	a,(hl)
+		dec	hl
+		ld	l,(hl)
+		ld	h,a		; HL = string
+next:
+		ld	a,(hl)
+		cp	e
+		ret	z		; HL points to the match
+		inc	hl
+		or	a
+		jr	nz,next
+		ld	h,a
+		ld	l,a
+		ret
@@ -0,0 +1,33 @@
+;
+;	strcmp for Z80. Characters compare as unsigned.
+;
+		.export _strcmp
+		.code
+
+_strcmp:
+		ld	hl,2
+		add	hl,sp
+		ld	e,(hl)
+		inc	hl
+		ld	d,(hl)		; DE = s1
+		inc	hl
+		ld	a,(hl)
+		inc	hl
+		ld	h,(hl)
+		ld	l,a		; HL = s2
+next:
+		ld	a,(de)
+		cp	(hl)
+		jr	nz,diff		; carry if s1 < s2
+		inc	de
+		inc	hl
+		or	a		; matched the terminator ?
+		jr	nz,next
+		ld	h,a
+		ld	l,a
+		ret
+diff:
+		ld	hl,1
+		ret	nc
+		ld	hl,-1
+		ret
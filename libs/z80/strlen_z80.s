@@ -0,0 +1,20 @@
+;
+;	strlen for Z80 using CPIR
+;
+		.export _strlen
+		.code
+
+_strlen:
+		pop	de
+		pop	hl
+		push	hl
+		push	de
+		push	bc
+		xor	a
+		ld	b,a
+		ld	c,a
+		cpir			; BC goes down by length + 1
+		ld	hl,-1
+		sbc	hl,bc		; carry is still clear from the xor
+		pop	bc
+		ret
@@ -0,0 +1,115 @@
+/*
+ * A pipeline whose middle pass gives up early, as cc0 does on a
+ * compile error under fcc --pipe. The writer has more to say than a
+ * pipe holds, so it must be killed by SIGPIPE for the run to finish.
+ * That only happens if no pass holds on to a spare pipe end, and
+ * under the emulators close on exec does nothing as exec stays in
+ * the same process. So the ends are closed by hand, as fcc does.
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+
+static char *self;
+static int pipein = -1;
+
+static pid_t start(char *pass, int in, int out) {
+  char *args[3];
+  pid_t pid;
+
+  pid = fork();
+  if (pid == -1) {
+    perror("fork");
+    exit(1);
+  }
+  if (pid == 0) {
+    if (in != -1) {
+      dup2(in, 0);
+      close(in);
+    }
+    if (out != -1) {
+      dup2(out, 1);
+      close(out);
+    }
+    if (pipein != -1)
+      close(pipein);
+    args[0] = self;
+    args[1] = pass;
+    args[2] = NULL;
+    execv(self, args);
+    perror(self);
+    exit(255);
+  }
+  if (in != -1)
+    close(in);
+  if (out != -1)
+    close(out);
+  return (pid);
+}
+
+static void report(char *pass, pid_t pid) {
+  int status;
+
+  if (waitpid(pid, &status, 0) != pid) {
+    perror("waitpid");
+    exit(1);
+  }
+  if (WIFSIGNALED(status))
+    printf("%s: killed\n", pass);
+  else
+    printf("%s: exit %d\n", pass, WEXITSTATUS(status));
+}
+
+int main(int argc, char *argv[]) {
+  char buf[80];
+  int fd[2];
+  int i, in;
+  pid_t writer, failer, reader;
+
+  self = argv[0];
+
+  /* Like cpp, more output than a pipe can hold */
+  if (argc > 1 && strcmp(argv[1], "writer") == 0) {
+    for (i = 0; i < 10000; i++)
+      printf("int x%d;\n", i);
+    return (0);
+  }
+  /* Like cc0 on a compile error */
+  if (argc > 1 && strcmp(argv[1], "failer") == 0) {
+    fgets(buf, sizeof(buf), stdin);
+    printf("failer: error at %s", buf);
+    return (1);
+  }
+  /* Like cc1 */
+  if (argc > 1 && strcmp(argv[1], "reader") == 0) {
+    while (fgets(buf, sizeof(buf), stdin))
+      printf("reader: %s", buf);
+    return (0);
+  }
+
+  /* writer | failer | reader */
+  if (pipe(fd) == -1) {
+    perror("pipe");
+    exit(1);
+  }
+  pipein = fd[0];
+  writer = start("writer", -1, fd[1]);
+  in = pipein;
+  if (pipe(fd) == -1) {
+    perror("pipe");
+    exit(1);
+  }
+  pipein = fd[0];
+  failer = start("failer", in, fd[1]);
+  in = pipein;
+  pipein = -1;
+  reader = start("reader", in, -1);
+
+  report("reader", reader);
+  report("failer", failer);
+  report("writer", writer);
+  return (0);
+}